@@ -0,0 +1,100 @@
+#include <zephyr/kernel.h>
+#include "../../stbs.h"
+
+LOG_MODULE_REGISTER(STBS_BENCH);
+
+// Dispatch cost benchmark: compares selecting the tasks due in a macrocycle with the
+// old per-tick, per-slot modulo scan against the precomputed dispatch table, which
+// only has entries for the ticks that release something.
+// Only the selection is timed (no k_wakeup).
+
+#define BENCH_ROUNDS 16
+
+static const uint32_t periods_ms[] = {10, 20, 40, 50, 100, 200};
+static char task_names[255][8];
+
+static volatile uint32_t sink;
+
+// Old dispatcher: visit every slot and test ticks % period_ticks
+static uint32_t dispatch_scan(STBS* scheduler, uint32_t ticks) {
+    uint32_t due = 0;
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task* current_task = &scheduler->task_list[i];
+        if (current_task->task_id != NULL) {
+            if (ticks % current_task->period_ticks == 0) {
+                due += i;
+            }
+        }
+    }
+    return due;
+}
+
+// New dispatcher: walk only the table entries of one event
+static uint32_t dispatch_table(STBS* scheduler, uint32_t e) {
+    uint32_t due = 0;
+    for (uint32_t i = scheduler->event_index[e]; i < scheduler->event_index[e + 1]; i++) {
+        due += scheduler->event_tasks[i];
+    }
+    return due;
+}
+
+static void run_bench(uint8_t n_tasks) {
+    STBS* scheduler = k_malloc(sizeof(STBS));
+    Task t;
+
+    if (scheduler == NULL || STBS_Init(scheduler, 10, n_tasks) != 0) {
+        LOG_ERR("Failed to allocate scheduler for %d tasks\n", n_tasks);
+        return;
+    }
+
+    // A rejected task would silently shrink the measured set
+    int added = 0;
+    for (int i = 0; i < n_tasks; i++) {
+        snprintf(task_names[i], sizeof(task_names[i]), "t%d", i);
+        if (Create_Task(&t, periods_ms[i % ARRAY_SIZE(periods_ms)], i % 16, task_names[i], NULL) == 0 &&
+            STBS_AddTask(scheduler, &t) == 0)
+            added++;
+    }
+    if (added != n_tasks)
+        LOG_WRN("Only %d of %d tasks were added\n", added, n_tasks);
+
+    uint32_t start = k_cycle_get_32();
+    STBS_CalculateTicks(scheduler);
+    uint32_t build_cycles = k_cycle_get_32() - start;
+
+    start = k_cycle_get_32();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (uint32_t k = 0; k < scheduler->cycle_ticks; k++) {
+            sink = dispatch_scan(scheduler, k);
+        }
+    }
+    uint32_t scan_cycles = (k_cycle_get_32() - start) / BENCH_ROUNDS;
+
+    start = k_cycle_get_32();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (uint32_t e = 0; e < scheduler->n_events; e++) {
+            sink = dispatch_table(scheduler, e);
+        }
+    }
+    uint32_t table_cycles = (k_cycle_get_32() - start) / BENCH_ROUNDS;
+
+    LOG_INF("%3d tasks: scan %u cyc/macrocycle (%u wakeups), table %u cyc/macrocycle (%u wakeups), "
+            "table build %u cyc\n", added, scan_cycles, scheduler->cycle_ticks,
+            table_cycles, scheduler->n_events, build_cycles);
+
+    free(scheduler->event_ticks);
+    free(scheduler->event_index);
+    free(scheduler->event_tasks);
+    free(scheduler->task_list);
+    free(scheduler->scratch);
+    k_free(scheduler);
+}
+
+int main(void)
+{
+        LOG_INF("STBS dispatch benchmark (%u cycles/s)\n", sys_clock_hw_cycles_per_sec());
+        run_bench(8);
+        run_bench(64);
+        run_bench(255);
+        return 0;
+}
@@ -0,0 +1,56 @@
+#include <zephyr/kernel.h>
+#include "../../stbs.h"
+
+LOG_MODULE_REGISTER(STBS_STATIC);
+
+// Build-time schedule: two thread tasks and a callback task defined with STBS_DEFINE.
+// Task slots and dispatch table are in static storage and filled before main, which
+// only starts the scheduler. Builds with twister as stbs.static_schedule.
+
+#define STACKSIZE 1024
+#define THREAD_PRIORITY 7
+
+extern STBS scheduler;
+
+static uint32_t heartbeats;
+
+static void sensor(void) {
+    while (1) {
+        STBS_WaitActivation(&scheduler);
+        k_busy_wait(500);  // stands in for reading the inputs
+    }
+}
+
+static void control(void) {
+    while (1) {
+        STBS_WaitActivation(&scheduler);
+        k_busy_wait(1000);  // stands in for the control law
+    }
+}
+
+static void heartbeat(void* ctx) {
+    (*(uint32_t*)ctx)++;
+}
+
+K_THREAD_DEFINE(sensor_thread, STACKSIZE, sensor, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
+K_THREAD_DEFINE(control_thread, STACKSIZE, control, NULL, NULL, NULL, THREAD_PRIORITY + 1, 0, 0);
+
+STBS_TASK_DEFINE_WCET(sensor_task, 20, 1, sensor_thread, 500, 0);
+STBS_TASK_DEFINE_WCET(control_task, 50, 2, control_thread, 1000, 0);
+STBS_CALLBACK_TASK_DEFINE_WCET(heartbeat_task, 100, 0, heartbeat, &heartbeats, 10, 0);
+STBS_DEFINE(scheduler, 100, sensor_task, control_task, heartbeat_task);
+
+int main(void) {
+    LOG_INF("Static schedule: tick %u ms, %u ticks per macrocycle\n",
+            scheduler.tick_ms, scheduler.cycle_ticks);
+    if (STBS_Start(&scheduler) != 0) {
+        LOG_ERR("Failed to start the scheduler\n");
+        return 0;
+    }
+
+    while (1) {
+        k_sleep(K_SECONDS(5));
+        STBS_printStats(&scheduler);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "buttons.h"
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(buttons);
+
+BUILD_ASSERT((BUTTONS_QUEUE_SIZE & (BUTTONS_QUEUE_SIZE - 1)) == 0,
+             "BUTTONS_QUEUE_SIZE tem de ser uma potência de 2");
+
+// Definir os botões (pinos GPIO) a partir dos aliases sw<i> que existem no devicetree
+#define BUTTON_SPEC(i, _)                                               \
+    COND_CODE_1(DT_NODE_EXISTS(DT_ALIAS(sw##i)),                        \
+                (GPIO_DT_SPEC_GET(DT_ALIAS(sw##i), gpios),), ())
+
+static const struct gpio_dt_spec buttons[] = {
+    LISTIFY(BUTTONS_MAX_CHANNELS, BUTTON_SPEC, ())
+};
+
+#define BUTTONS_COUNT ARRAY_SIZE(buttons)
+
+BUILD_ASSERT(BUTTONS_COUNT <= 32, "Máscaras de botões com 32 bits");
+
+struct button_channel {
+    struct gpio_callback callback;
+    struct k_work_delayable debounce;
+    uint8_t index;
+    bool state;     // último estado reportado
+    bool locked;    // dentro da janela de debounce
+};
+
+static struct button_channel channels[BUTTONS_COUNT];
+
+// Fila de eventos; escrita pela ISR e pela workqueue, lida pela tarefa
+static struct k_spinlock buttons_lock;
+static button_event queue[BUTTONS_QUEUE_SIZE];
+static uint32_t queue_head;     // próximo a ler
+static uint32_t queue_tail;     // próximo a escrever
+static uint32_t dropped;
+
+// Regista uma mudança de estado; chamada com buttons_lock
+static void button_report(struct button_channel *ch, bool pressed, int64_t timestamp) {
+    ch->state = pressed;
+    if (queue_tail - queue_head == BUTTONS_QUEUE_SIZE) {
+        dropped++;
+        return;
+    }
+    button_event *event = &queue[queue_tail++ & (BUTTONS_QUEUE_SIZE - 1)];
+    event->timestamp = timestamp;
+    event->channel = ch->index;
+    event->pressed = pressed;
+}
+
+// Interrupção de um botão: a primeira transição fora da janela de debounce é
+// uma mudança de estado; abre a janela
+static void button_edge(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins) {
+    struct button_channel *ch = CONTAINER_OF(cb, struct button_channel, callback);
+    int64_t now = k_uptime_ticks();
+
+    ARG_UNUSED(port);
+    ARG_UNUSED(pins);
+
+    k_spinlock_key_t key = k_spin_lock(&buttons_lock);
+    if (!ch->locked) {
+        ch->locked = true;
+        button_report(ch, !ch->state, now);
+        k_work_reschedule(&ch->debounce, K_MSEC(BUTTONS_DEBOUNCE_MS));
+    }
+    k_spin_unlock(&buttons_lock, key);
+}
+
+// Fim da janela de debounce: reporta o que mudou durante a janela
+static void button_debounced(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct button_channel *ch = CONTAINER_OF(dwork, struct button_channel, debounce);
+    bool pressed = gpio_pin_get_dt(&buttons[ch->index]) > 0;
+
+    k_spinlock_key_t key = k_spin_lock(&buttons_lock);
+    if (pressed != ch->state) {
+        button_report(ch, pressed, k_uptime_ticks());
+        k_work_reschedule(&ch->debounce, K_MSEC(BUTTONS_DEBOUNCE_MS));
+    } else {
+        ch->locked = false;
+    }
+    k_spin_unlock(&buttons_lock, key);
+}
+
+// Inicializar os botões
+int buttons_init(void) {
+    queue_head = 0;
+    queue_tail = 0;
+    dropped = 0;
+
+    for (int i = 0; i < BUTTONS_COUNT; i++) {
+        const struct gpio_dt_spec *spec = &buttons[i];
+        struct button_channel *ch = &channels[i];
+
+        if (!device_is_ready(spec->port)) {
+            LOG_ERR("GPIO device is not ready for buttons\n");
+            return -ENODEV;
+        }
+
+        // Os flags do devicetree (GPIO_ACTIVE_LOW, pull-up) ficam no pino: 1 = pressionado
+        int err = gpio_pin_configure_dt(spec, GPIO_INPUT);
+        if (err != 0) {
+            LOG_ERR("Failed to configure button %d (%d)\n", i, err);
+            return err;
+        }
+
+        ch->index = i;
+        ch->state = gpio_pin_get_dt(spec) > 0;
+        ch->locked = false;
+        k_work_init_delayable(&ch->debounce, button_debounced);
+        gpio_init_callback(&ch->callback, button_edge, BIT(spec->pin));
+        err = gpio_add_callback(spec->port, &ch->callback);
+        if (err == 0)
+            err = gpio_pin_interrupt_configure_dt(spec, GPIO_INT_EDGE_BOTH);
+        if (err != 0) {
+            LOG_ERR("Failed to enable interrupts of button %d (%d)\n", i, err);
+            return err;
+        }
+    }
+
+    LOG_INF("%d buttons have been initialized successfully\n", (int)BUTTONS_COUNT);
+    return 0;
+}
+
+int buttons_count(void) {
+    return BUTTONS_COUNT;
+}
+
+uint32_t buttons_state(void) {
+    uint32_t mask = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&buttons_lock);
+    for (int i = 0; i < BUTTONS_COUNT; i++) {
+        if (channels[i].state)
+            mask |= BIT(i);
+    }
+    k_spin_unlock(&buttons_lock, key);
+    return mask;
+}
+
+int buttons_get_events(button_event *events, int max) {
+    int n = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&buttons_lock);
+    while (n < max && queue_head != queue_tail) {
+        events[n++] = queue[queue_head++ & (BUTTONS_QUEUE_SIZE - 1)];
+    }
+    k_spin_unlock(&buttons_lock, key);
+    return n;
+}
+
+uint32_t buttons_dropped(void) {
+    return dropped;
+}
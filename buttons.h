@@ -0,0 +1,45 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <zephyr/drivers/gpio.h>
+
+// Número máximo de aliases sw<i> procurados no devicetree
+#ifndef BUTTONS_MAX_CHANNELS
+#define BUTTONS_MAX_CHANNELS 8
+#endif
+
+// Janela de debounce depois de cada mudança reportada
+#ifndef BUTTONS_DEBOUNCE_MS
+#define BUTTONS_DEBOUNCE_MS 20
+#endif
+
+// Eventos guardados até serem lidos (potência de 2)
+#ifndef BUTTONS_QUEUE_SIZE
+#define BUTTONS_QUEUE_SIZE 16
+#endif
+
+// Mudança de estado de um botão
+typedef struct {
+    int64_t timestamp;      // kernel ticks da interrupção (ou do fim da janela de debounce)
+    uint8_t channel;        // índice do alias sw<i>
+    bool pressed;
+} button_event;
+
+// Os botões são os aliases sw0, sw1, ... do devicetree, com interrupções nas duas
+// transições. A primeira transição é reportada logo na ISR, com o instante em que
+// ocorreu; as seguintes são ignoradas durante BUTTONS_DEBOUNCE_MS. No fim da janela o
+// pino é lido de novo e, se o estado mudou entretanto, é reportado também, por isso
+// um toque mais curto que a janela (ou que o período da tarefa) não se perde.
+int buttons_init(void);
+int buttons_count(void);
+
+// Estado estável de todos os botões, um bit por botão (1 = pressionado)
+uint32_t buttons_state(void);
+
+// Tira até max eventos da fila, do mais antigo para o mais recente; retorna quantos
+int buttons_get_events(button_event *events, int max);
+
+// Eventos perdidos por a fila estar cheia
+uint32_t buttons_dropped(void);
+
+#endif // BUTTONS_H
@@ -0,0 +1,151 @@
+#include "../../rtdb.h"
+#include <pthread.h>
+#include <time.h>
+
+// RTDB against the app's single-mutex RTDB.
+// One writer refreshes the I/O state in a loop, with some work per update standing in
+// for GPIO access and logging. With the mutex, that work happens inside the lock, as in
+// the app; with the RTDB the writer prepares the value and then writes it. Reader
+// threads read the state as fast as they can; the benchmark reports reads per second
+// and the worst read latency. Uncontended single-thread costs come first.
+
+#define READERS 3
+#define RUN_MS 300
+#define WORK_NS 2000
+
+enum { IO_INPUTS, IO_OUTPUTS };
+
+static const RTDB_FieldDef io_fields[] = {
+    [IO_INPUTS] = {"inputs", 4},
+    [IO_OUTPUTS] = {"outputs", 4},
+};
+
+typedef struct {
+    uint8_t inputs[4];
+    uint8_t outputs[4];
+} MutexRTDB;
+
+static RTDB rtdb;
+static MutexRTDB mutex_rtdb;
+static pthread_mutex_t rtdb_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool stop;
+static bool use_mutex;
+
+typedef struct {
+    uint64_t reads;
+    uint64_t max_ns;
+} ReaderResult;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void work(void) {
+    uint64_t end = now_ns() + WORK_NS;
+    while (now_ns() < end) {
+    }
+}
+
+static void* writer(void* arg) {
+    uint8_t inputs[4];
+    for (uint32_t n = 0; !stop; n++) {
+        if (use_mutex) {
+            pthread_mutex_lock(&rtdb_mutex);
+            work();
+            memset(mutex_rtdb.inputs, n & 1, sizeof(mutex_rtdb.inputs));
+            pthread_mutex_unlock(&rtdb_mutex);
+        } else {
+            work();
+            memset(inputs, n & 1, sizeof(inputs));
+            RTDB_Write(&rtdb, IO_INPUTS, inputs);
+        }
+    }
+    return NULL;
+}
+
+static void* reader(void* arg) {
+    ReaderResult* result = arg;
+    uint8_t inputs[4];
+
+    while (!stop) {
+        uint64_t start = now_ns();
+        if (use_mutex) {
+            pthread_mutex_lock(&rtdb_mutex);
+            memcpy(inputs, mutex_rtdb.inputs, sizeof(inputs));
+            pthread_mutex_unlock(&rtdb_mutex);
+        } else {
+            RTDB_Read(&rtdb, IO_INPUTS, inputs, NULL);
+        }
+        uint64_t elapsed = now_ns() - start;
+        result->reads++;
+        result->max_ns = MAX(result->max_ns, elapsed);
+    }
+    return NULL;
+}
+
+static void run_contended(bool mutex) {
+    pthread_t writer_thread, reader_threads[READERS];
+    ReaderResult results[READERS] = {0};
+    struct timespec run = {0, RUN_MS * 1000000L};
+
+    use_mutex = mutex;
+    stop = false;
+    pthread_create(&writer_thread, NULL, writer, NULL);
+    for (int i = 0; i < READERS; i++) {
+        pthread_create(&reader_threads[i], NULL, reader, &results[i]);
+    }
+    nanosleep(&run, NULL);
+    stop = true;
+    pthread_join(writer_thread, NULL);
+
+    uint64_t reads = 0, max_ns = 0;
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(reader_threads[i], NULL);
+        reads += results[i].reads;
+        max_ns = MAX(max_ns, results[i].max_ns);
+    }
+    printf("%-6s %d readers + writer: %10llu reads/s, worst read %8llu ns\n",
+           mutex ? "mutex" : "rtdb", READERS,
+           (unsigned long long)(reads * 1000 / RUN_MS), (unsigned long long)max_ns);
+}
+
+static void run_uncontended(void) {
+    const int rounds = 1000000;
+    uint8_t value[4] = {0};
+    uint64_t start;
+
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        pthread_mutex_lock(&rtdb_mutex);
+        memcpy(value, mutex_rtdb.inputs, sizeof(value));
+        pthread_mutex_unlock(&rtdb_mutex);
+    }
+    uint64_t mutex_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        RTDB_Read(&rtdb, IO_INPUTS, value, NULL);
+    }
+    uint64_t read_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        RTDB_Write(&rtdb, IO_INPUTS, value);
+    }
+    uint64_t write_ns = now_ns() - start;
+
+    printf("uncontended: mutex read %.1f ns, rtdb read %.1f ns, rtdb write %.1f ns\n",
+           (double)mutex_ns / rounds, (double)read_ns / rounds, (double)write_ns / rounds);
+}
+
+int main(void) {
+    if (RTDB_Init(&rtdb, io_fields, ARRAY_SIZE(io_fields)) != 0)
+        return 1;
+
+    run_uncontended();
+    run_contended(true);
+    run_contended(false);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "../../stbs.h"
+#include <stdlib.h>
+#include <time.h>
+
+// Host benchmark of the STBS core on the virtual clock: cost of building the dispatch
+// table and of one dispatcher pass, for the task sets of STBS_bench.
+// Wakeups go nowhere, so only the scheduler's own work is timed.
+
+#define BUILD_ROUNDS 64
+#define DISPATCH_CYCLES 20000
+
+static const uint32_t periods_ms[] = {10, 20, 40, 50, 100, 200};
+static struct k_thread threads[255];
+static char task_names[255][8];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void run_bench(uint8_t n_tasks) {
+    STBS scheduler;
+    Task t;
+
+    if (STBS_Init(&scheduler, 10, n_tasks) != 0) {
+        LOG_ERR("Failed to allocate scheduler for %d tasks\n", n_tasks);
+        return;
+    }
+    // A rejected task would silently shrink the measured set
+    int added = 0;
+    for (int i = 0; i < n_tasks; i++) {
+        snprintf(task_names[i], sizeof(task_names[i]), "t%d", i);
+        if (Create_Task(&t, periods_ms[i % ARRAY_SIZE(periods_ms)], i % 16, task_names[i], &threads[i]) == 0 &&
+            STBS_AddTask(&scheduler, &t) == 0)
+            added++;
+    }
+    if (added != n_tasks)
+        fprintf(stderr, "Only %d of %d tasks were added\n", added, n_tasks);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < BUILD_ROUNDS; i++) {
+        STBS_CalculateTicks(&scheduler);
+    }
+    uint64_t build_ns = (now_ns() - start) / BUILD_ROUNDS;
+
+    stbs_host_set_time(0);
+    STBS_Start(&scheduler);
+    uint64_t passes = (uint64_t)DISPATCH_CYCLES * scheduler.n_events;
+    start = now_ns();
+    for (uint64_t i = 0; i < passes; i++) {
+        STBS_Dispatch(&scheduler);
+    }
+    uint64_t dispatch_ns = now_ns() - start;
+    STBS_Stop(&scheduler);
+
+    printf("%3d tasks: table build %8llu ns, %u events/macrocycle, dispatch %6llu ns/event, "
+           "%llu ns/macrocycle\n",
+           added, (unsigned long long)build_ns, scheduler.n_events,
+           (unsigned long long)(dispatch_ns / passes),
+           (unsigned long long)(dispatch_ns / DISPATCH_CYCLES));
+
+    free(scheduler.event_ticks);
+    free(scheduler.event_index);
+    free(scheduler.event_tasks);
+    free(scheduler.task_list);
+    free(scheduler.scratch);
+}
+
+int main(void) {
+    run_bench(8);
+    run_bench(64);
+    run_bench(255);
+    return 0;
+}
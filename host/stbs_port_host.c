@@ -0,0 +1,120 @@
+#include "stbs_port_host.h"
+#include <time.h>
+
+// Virtual clock, in kernel ticks
+static int64_t now_ticks;
+static uint64_t busy_ticks;
+static uint64_t idle_ticks;
+static k_tid_t current_thread;
+
+void (*stbs_host_on_wakeup)(k_tid_t thread);
+
+// Moving the clock forward stands for work; moving it back restarts a simulation
+void stbs_host_set_time(int64_t ticks) {
+    if (ticks > now_ticks)
+        busy_ticks += ticks - now_ticks;
+    now_ticks = ticks;
+}
+
+void stbs_host_set_current(k_tid_t thread) {
+    current_thread = thread;
+}
+
+// No thread is started: the harness calls STBS_Dispatch() in place of the entry loop
+k_tid_t k_thread_create(struct k_thread* thread, char* stack, size_t stack_size,
+                        k_thread_entry_t entry, void* p1, void* p2, void* p3,
+                        int prio, uint32_t options, k_timeout_t delay) {
+    thread->name = "stbs";
+    thread->prio = prio;
+    thread->wakeups = 0;
+    return thread;
+}
+
+void k_thread_abort(k_tid_t thread) {
+}
+
+void k_wakeup(k_tid_t thread) {
+    if (thread != NULL)
+        thread->wakeups++;
+    if (stbs_host_on_wakeup != NULL)
+        stbs_host_on_wakeup(thread);
+}
+
+k_tid_t k_current_get(void) {
+    return current_thread;
+}
+
+int k_thread_priority_get(k_tid_t thread) {
+    return thread->prio;
+}
+
+void k_thread_priority_set(k_tid_t thread, int prio) {
+    thread->prio = prio;
+}
+
+// Sleeping to an absolute time moves the clock there; nothing else can advance it
+int32_t k_sleep(k_timeout_t timeout) {
+    if (timeout.ticks > now_ticks) {
+        idle_ticks += timeout.ticks - now_ticks;
+        now_ticks = timeout.ticks;
+    }
+    return 0;
+}
+
+int k_mutex_init(struct k_mutex* mutex) {
+    mutex->locked = 0;
+    return 0;
+}
+
+int k_mutex_lock(struct k_mutex* mutex, k_timeout_t timeout) {
+    mutex->locked++;
+    return 0;
+}
+
+int k_mutex_unlock(struct k_mutex* mutex) {
+    mutex->locked--;
+    return 0;
+}
+
+k_spinlock_key_t k_spin_lock(struct k_spinlock* lock) {
+    return lock->locked++;
+}
+
+void k_spin_unlock(struct k_spinlock* lock, k_spinlock_key_t key) {
+    lock->locked = key;
+}
+
+int k_sem_init(struct k_sem* sem, unsigned int initial_count, unsigned int limit) {
+    sem->count = initial_count;
+    sem->limit = limit;
+    return 0;
+}
+
+void k_sem_give(struct k_sem* sem) {
+    if (sem->count < sem->limit)
+        sem->count++;
+}
+
+// Never blocks: without a release to take, the caller is told to try again
+int k_sem_take(struct k_sem* sem, k_timeout_t timeout) {
+    if (sem->count == 0)
+        return -11;  // -EAGAIN
+    sem->count--;
+    return 0;
+}
+
+int64_t k_uptime_ticks(void) {
+    return now_ticks;
+}
+
+uint32_t k_cycle_get_32(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+int k_thread_runtime_stats_all_get(k_thread_runtime_stats_t* stats) {
+    stats->execution_cycles = busy_ticks + idle_ticks;
+    stats->total_cycles = busy_ticks;
+    return 0;
+}
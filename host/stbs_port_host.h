@@ -0,0 +1,156 @@
+#ifndef DEF_STBS_PORT_HOST
+#define DEF_STBS_PORT_HOST
+
+// Host implementation of the kernel API used by the STBS core.
+// Time is virtual: k_uptime_ticks() reads a counter that only moves when the
+// dispatcher sleeps, so a simulation runs as fast as the dispatcher itself.
+// There are no threads. STBS_Start only records the scheduler; the harness drives
+// the dispatcher with STBS_Dispatch() and sees the releases through stbs_host_on_wakeup.
+// The cycle counter is the real monotonic clock in ns, so overhead statistics
+// measure the host.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef CONFIG_SYS_CLOCK_TICKS_PER_SEC
+#define CONFIG_SYS_CLOCK_TICKS_PER_SEC 32768
+#endif
+
+// Threads
+struct k_thread {
+    const char* name;
+    int prio;
+    uint32_t wakeups;
+};
+typedef struct k_thread* k_tid_t;
+typedef void (*k_thread_entry_t)(void* p1, void* p2, void* p3);
+
+// Timeouts: absolute tick, or one of the two constants below
+typedef struct {
+    int64_t ticks;
+} k_timeout_t;
+
+#define K_FOREVER ((k_timeout_t){-1})
+#define K_NO_WAIT ((k_timeout_t){0})
+#define K_TIMEOUT_ABS_TICKS(t) ((k_timeout_t){(t)})
+
+#define K_THREAD_STACK_DEFINE(sym, size) char sym[size]
+#define K_THREAD_STACK_SIZEOF(sym) sizeof(sym)
+
+// Locks: the simulation is single-threaded, they only keep the core unchanged
+struct k_mutex {
+    int locked;
+};
+struct k_spinlock {
+    int locked;
+};
+typedef int k_spinlock_key_t;
+
+struct k_sem {
+    unsigned int count;
+    unsigned int limit;
+};
+
+// Atomics and barriers, with the compiler builtins
+typedef long atomic_t;
+typedef atomic_t atomic_val_t;
+
+static inline atomic_val_t atomic_get(const atomic_t* target) {
+    return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_set(atomic_t* target, atomic_val_t value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_inc(atomic_t* target) {
+    return __atomic_fetch_add(target, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline void barrier_dmem_fence_full(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define ARG_UNUSED(x) (void)(x)
+#define BUILD_ASSERT(cond, ...) _Static_assert(cond, "" __VA_ARGS__)
+
+// Logging: errors and warnings go to stderr, the rest only with STBS_HOST_VERBOSE
+#define LOG_MODULE_REGISTER(name)
+#define LOG_ERR(...) fprintf(stderr, __VA_ARGS__)
+#define LOG_WRN(...) fprintf(stderr, __VA_ARGS__)
+#ifdef STBS_HOST_VERBOSE
+#define LOG_INF(...) printf(__VA_ARGS__)
+#else
+#define LOG_INF(...) do { if (0) printf(__VA_ARGS__); } while (0)  // arguments still used
+#endif
+#define printk(...) printf(__VA_ARGS__)
+
+k_tid_t k_thread_create(struct k_thread* thread, char* stack, size_t stack_size,
+                        k_thread_entry_t entry, void* p1, void* p2, void* p3,
+                        int prio, uint32_t options, k_timeout_t delay);
+void k_thread_abort(k_tid_t thread);
+void k_wakeup(k_tid_t thread);
+k_tid_t k_current_get(void);
+int k_thread_priority_get(k_tid_t thread);
+void k_thread_priority_set(k_tid_t thread, int prio);
+int32_t k_sleep(k_timeout_t timeout);
+
+int k_mutex_init(struct k_mutex* mutex);
+int k_mutex_lock(struct k_mutex* mutex, k_timeout_t timeout);
+int k_mutex_unlock(struct k_mutex* mutex);
+k_spinlock_key_t k_spin_lock(struct k_spinlock* lock);
+void k_spin_unlock(struct k_spinlock* lock, k_spinlock_key_t key);
+
+int k_sem_init(struct k_sem* sem, unsigned int initial_count, unsigned int limit);
+void k_sem_give(struct k_sem* sem);
+int k_sem_take(struct k_sem* sem, k_timeout_t timeout);
+
+int64_t k_uptime_ticks(void);
+uint32_t k_cycle_get_32(void);
+
+// CPU usage accounting, in kernel ticks of the virtual clock: time the clock moves
+// in k_sleep is idle, time moved by stbs_host_set_time is busy
+#define CONFIG_SCHED_THREAD_USAGE_ALL 1
+typedef struct {
+    uint64_t execution_cycles;  // idle and busy
+    uint64_t total_cycles;      // busy
+} k_thread_runtime_stats_t;
+
+int k_thread_runtime_stats_all_get(k_thread_runtime_stats_t* stats);
+
+// The host cycle counter counts nanoseconds
+static inline uint32_t sys_clock_hw_cycles_per_sec(void) {
+    return 1000000000u;
+}
+
+static inline uint64_t k_ms_to_ticks_ceil64(uint64_t ms) {
+    return (ms * CONFIG_SYS_CLOCK_TICKS_PER_SEC + 999) / 1000;
+}
+
+static inline uint64_t k_ticks_to_ms_floor64(uint64_t ticks) {
+    return ticks * 1000 / CONFIG_SYS_CLOCK_TICKS_PER_SEC;
+}
+
+static inline uint64_t k_ticks_to_us_floor64(uint64_t ticks) {
+    return ticks * 1000000 / CONFIG_SYS_CLOCK_TICKS_PER_SEC;
+}
+
+static inline uint32_t k_ticks_to_us_floor32(uint32_t ticks) {
+    return (uint32_t)k_ticks_to_us_floor64(ticks);
+}
+
+static inline uint32_t k_cyc_to_us_floor32(uint32_t cycles) {
+    return cycles / 1000;
+}
+
+// Simulator control
+extern void (*stbs_host_on_wakeup)(k_tid_t thread);  // called on every k_wakeup
+void stbs_host_set_time(int64_t ticks);             // moves the virtual clock
+void stbs_host_set_current(k_tid_t thread);         // thread k_current_get() reports
+
+#endif
@@ -0,0 +1,125 @@
+#include "../../rtdb.h"
+#include <pthread.h>
+#include <sched.h>
+
+// Tests of the RTDB: versions and timestamps on the virtual clock, bounds, and
+// consistent reads while a writer thread rewrites a field as fast as it can.
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+enum { IO_INPUTS, IO_OUTPUTS, IO_FRAME };
+
+static const RTDB_FieldDef io_fields[] = {
+    [IO_INPUTS] = {"inputs", 4},
+    [IO_OUTPUTS] = {"outputs", 4},
+    [IO_FRAME] = {"frame", 61},
+};
+
+static int test_versions(void) {
+    RTDB db;
+    RTDB_Meta meta;
+    uint8_t value[4];
+    const uint8_t inputs[4] = {1, 0, 1, 0};
+
+    stbs_host_set_time(0);
+    CHECK(RTDB_Init(&db, io_fields, ARRAY_SIZE(io_fields)) == 0);
+    CHECK(RTDB_Read(&db, IO_INPUTS, value, &meta) == 0);
+    CHECK(meta.version == 0 && value[0] == 0);
+
+    stbs_host_set_time(1234);
+    CHECK(RTDB_Write(&db, IO_INPUTS, inputs) == 0);
+    CHECK(RTDB_Read(&db, IO_INPUTS, value, &meta) == 0);
+    CHECK(memcmp(value, inputs, 4) == 0);
+    CHECK(meta.version == 1 && meta.timestamp == 1234);
+    CHECK(RTDB_Version(&db, IO_INPUTS) == 1);
+    CHECK(RTDB_Version(&db, IO_OUTPUTS) == 0);
+
+    // Partial write of one entry
+    uint8_t one = 7;
+    stbs_host_set_time(2000);
+    CHECK(RTDB_WriteAt(&db, IO_INPUTS, 2, &one, 1) == 0);
+    CHECK(RTDB_Read(&db, IO_INPUTS, value, &meta) == 0);
+    CHECK(value[0] == 1 && value[2] == 7 && meta.version == 2 && meta.timestamp == 2000);
+
+    // Out of bounds
+    CHECK(RTDB_WriteAt(&db, IO_INPUTS, 3, inputs, 2) == -1);
+    CHECK(RTDB_Write(&db, 3, inputs) == -1);
+    CHECK(RTDB_Read(&db, 3, value, NULL) == -1);
+    CHECK(RTDB_Version(&db, IO_INPUTS) == 2);
+
+    // Fields do not overlap
+    uint8_t frame[61];
+    memset(frame, 0xFF, sizeof(frame));
+    CHECK(RTDB_Write(&db, IO_FRAME, frame) == 0);
+    CHECK(RTDB_Read(&db, IO_OUTPUTS, value, NULL) == 0);
+    CHECK(value[0] == 0 && value[3] == 0);
+    return 0;
+}
+
+static RTDB shared;
+static volatile bool stop;
+
+// Writes frames whose bytes are all equal, so a torn read is easy to see
+static void* writer(void* arg) {
+    uint8_t frame[61];
+    for (uint32_t n = 0; !stop; n++) {
+        memset(frame, n & 0xFF, sizeof(frame));
+        RTDB_Write(&shared, IO_FRAME, frame);
+    }
+    return NULL;
+}
+
+static int test_concurrent(void) {
+    pthread_t thread;
+    uint8_t frame[61];
+    RTDB_Meta meta;
+    uint32_t last_version = 0;
+
+    CHECK(RTDB_Init(&shared, io_fields, ARRAY_SIZE(io_fields)) == 0);
+    stop = false;
+    CHECK(pthread_create(&thread, NULL, writer, NULL) == 0);
+    while (RTDB_Version(&shared, IO_FRAME) == 0) {
+        sched_yield();
+    }
+
+    for (int i = 0; i < 200000; i++) {
+        RTDB_Read(&shared, IO_FRAME, frame, &meta);
+        for (size_t b = 1; b < sizeof(frame); b++) {
+            CHECK(frame[b] == frame[0]);
+        }
+        CHECK(meta.version >= last_version);
+        CHECK(meta.version == 0 || frame[0] == ((meta.version - 1) & 0xFF));
+        last_version = meta.version;
+    }
+
+    stop = true;
+    pthread_join(thread, NULL);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    static const struct {
+        const char* name;
+        int (*run)(void);
+    } tests[] = {
+        {"versions", test_versions},
+        {"concurrent", test_concurrent},
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(tests); i++) {
+        if (argc < 2 || strcmp(argv[1], tests[i].name) == 0) {
+            if (tests[i].run() != 0) {
+                fprintf(stderr, "%s: FAILED\n", tests[i].name);
+                return 1;
+            }
+            printf("%s: passed\n", tests[i].name);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1124 @@
+#include "../../stbs.h"
+#include <stdlib.h>
+#include <time.h>
+
+// Virtual-time tests of the STBS core: every release the dispatcher makes is recorded
+// with its (virtual) time and compared against the schedule worked out independently.
+// Run with the name of one test, see main().
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+#define MAX_RECORDS 4096
+
+typedef struct {
+    int64_t time;
+    k_tid_t thread;
+} Record;
+
+static Record records[MAX_RECORDS];
+static uint32_t n_records;
+static uint64_t total_wakeups;
+
+static struct k_thread threads[255];
+static char names[255][8];
+
+static void record_wakeup(k_tid_t thread) {
+    if (n_records < MAX_RECORDS) {
+        records[n_records].time = k_uptime_ticks();
+        records[n_records].thread = thread;
+        n_records++;
+    }
+    total_wakeups++;
+}
+
+static void sim_reset(void) {
+    stbs_host_set_time(0);
+    stbs_host_on_wakeup = record_wakeup;
+    n_records = 0;
+    total_wakeups = 0;
+    for (int i = 0; i < 255; i++) {
+        snprintf(names[i], sizeof(names[i]), "t%d", i);
+        threads[i].name = names[i];
+        threads[i].prio = 0;
+        threads[i].wakeups = 0;
+    }
+}
+
+// One pass of the loop of thread i: STBS_WaitActivation completes the job in progress,
+// if any, and starts the next one if it was released; otherwise the thread stays waiting
+static void thread_wait(STBS* scheduler, int i) {
+    stbs_host_set_current(&threads[i]);
+    STBS_WaitActivation(scheduler);
+    stbs_host_set_current(NULL);
+}
+
+// Thread i has a job in progress
+static bool thread_running(STBS* scheduler, int i) {
+    for (int j = 0; j < scheduler->max_tasks; j++) {
+        Task* t = &scheduler->task_list[j];
+        if (t->task_id != NULL && t->tid == &threads[i] && t->retire_gen == 0)
+            return t->state == STBS_TASK_RUNNING;
+    }
+    return false;
+}
+
+static int add_task(STBS* scheduler, int i, uint32_t period_ms, uint8_t priority) {
+    Task t;
+    Create_Task(&t, period_ms, priority, names[i], &threads[i]);
+    return STBS_AddTask(scheduler, &t);
+}
+
+// Expected releases of one tick: due tasks in priority order, equal priorities in slot order
+static uint32_t expected_tick(const uint32_t* periods, const uint8_t* prios, int n,
+                              uint64_t ms, k_tid_t* due) {
+    uint32_t count = 0;
+    for (int p = 0; p < 256; p++) {
+        for (int i = 0; i < n; i++) {
+            if (prios[i] == p && ms % periods[i] == 0)
+                due[count++] = &threads[i];
+        }
+    }
+    return count;
+}
+
+// Exact release sequence and times of a small set over the first records, then
+// the activation counts after one hour
+static int test_sequence(void) {
+    static const uint32_t periods[] = {10, 20, 50, 30};
+    static const uint8_t prios[] = {3, 1, 2, 1};
+    const int n = ARRAY_SIZE(periods);
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, n) == 0);
+    for (int i = 0; i < n; i++) {
+        CHECK(add_task(&scheduler, i, periods[i], prios[i]) == 0);
+    }
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.tick_ms == 10);
+    CHECK(scheduler.cycle_ticks == 30);
+
+    uint64_t hour_ms = 3600ull * 1000;
+    uint32_t dispatches = 0;
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(hour_ms) || dispatches == 0) {
+        STBS_Dispatch(&scheduler);
+        dispatches++;
+    }
+
+    // Replay the recorded releases against the reference schedule
+    uint32_t r = 0;
+    for (uint64_t ms = 0; r < n_records; ms += 10) {
+        k_tid_t due[8];
+        uint32_t count = expected_tick(periods, prios, n, ms, due);
+        for (uint32_t j = 0; j < count && r < n_records; j++, r++) {
+            CHECK(records[r].thread == due[j]);
+            CHECK(records[r].time == (int64_t)k_ms_to_ticks_ceil64(ms));
+        }
+    }
+
+    // The last dispatch released the tasks due at the hour mark
+    for (int i = 0; i < n; i++) {
+        CHECK(threads[i].wakeups == hour_ms / periods[i] + 1);
+    }
+    CHECK(scheduler.missed_ticks == 0);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// 255 tasks for several hours of virtual time
+static int test_long_run(void) {
+    static const uint32_t periods[] = {10, 20, 40, 50, 100, 200};
+    const uint32_t hours = 4;
+    const uint64_t cycles = hours * 3600ull * 1000 / 200;
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 255) == 0);
+    for (int i = 0; i < 255; i++) {
+        CHECK(add_task(&scheduler, i, periods[i % ARRAY_SIZE(periods)], i % 16) == 0);
+    }
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.cycle_ticks == 20);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t i = 0; i < cycles * scheduler.n_events; i++) {
+        STBS_Dispatch(&scheduler);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < 255; i++) {
+        CHECK(threads[i].wakeups == cycles * 200 / periods[i % ARRAY_SIZE(periods)]);
+    }
+    // Last event of the last macrocycle is at 190 ms
+    CHECK(k_uptime_ticks() == (int64_t)k_ms_to_ticks_ceil64((cycles - 1) * 200 + 190));
+    CHECK(scheduler.missed_ticks == 0);
+
+    // The release rate is the cost of the dispatcher hot path; ctest bounds the wall time
+    double wall_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("%u h of 255 tasks: %llu releases in %.1f ms, %.1f M releases/s (%.1f ns each)\n",
+           hours, (unsigned long long)total_wakeups, wall_ms,
+           total_wakeups / wall_ms / 1e3, wall_ms * 1e6 / total_wakeups);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A task added while running starts at the next macrocycle boundary, a removed one
+// stops there; the tasks that stay keep their release times
+static int test_mode_change(void) {
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 1, 20, 2) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    STBS_Dispatch(&scheduler);  // 0 ms: t0, t1
+    STBS_Dispatch(&scheduler);  // 10 ms: t0
+    CHECK(add_task(&scheduler, 2, 50, 0) == 0);
+    CHECK(STBS_RemoveTask(&scheduler, names[1]) == 0);
+    CHECK(threads[2].wakeups == 0);
+
+    STBS_Dispatch(&scheduler);  // 20 ms: boundary, new set: t2, t0
+    CHECK(n_records == 5);
+    CHECK(records[3].thread == &threads[2]);
+    CHECK(records[4].thread == &threads[0]);
+    CHECK(records[3].time == (int64_t)k_ms_to_ticks_ceil64(20));
+    CHECK(scheduler.cycle_ticks == 5);
+
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(120)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(threads[0].wakeups == 13);    // 0 .. 120 ms
+    CHECK(threads[1].wakeups == 1);     // only at 0 ms
+    CHECK(threads[2].wakeups == 3);     // 20, 70, 120 ms
+    CHECK(records[n_records - 1].time == (int64_t)k_ms_to_ticks_ceil64(120));
+    CHECK(scheduler.start_time == 0);   // the swap moved the cycle base only
+    CHECK(scheduler.ticks == 12);       // 10 ms ticks since the start
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A mode change that changes the tick keeps ticks on elapsed time, in the new tick: 10 ms,
+// then 5 ms once t1 comes in, then 10 ms again; and from 15 ms to 10 ms
+static int test_mode_change_tick(void) {
+    STBS scheduler;
+    STBS_Stats stats;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(50)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(scheduler.ticks == 5);
+
+    CHECK(add_task(&scheduler, 1, 5, 2) == 0);
+    CHECK(scheduler.task_list[0].period_ticks == 1);     // Still the dispatched 10 ms table
+    STBS_Dispatch(&scheduler);  // 60 ms: boundary, t1, t0
+    CHECK(scheduler.tick_ms == 5);
+    CHECK(scheduler.ticks == 12);
+    CHECK(scheduler.task_list[0].period_ticks == 2 && scheduler.task_list[1].period_ticks == 1);
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(100)) {
+        STBS_Dispatch(&scheduler);
+    }
+    STBS_GetStats(&scheduler, &stats);
+    CHECK(stats.ticks == 20);
+    CHECK(threads[0].wakeups == 11 && threads[1].wakeups == 9);     // 0 .. 100 ms, 60 .. 100 ms
+
+    CHECK(STBS_RemoveTask(&scheduler, names[1]) == 0);
+    STBS_Dispatch(&scheduler);  // 105 ms: t1, the last one
+    STBS_Dispatch(&scheduler);  // 110 ms: boundary, t0
+    CHECK(scheduler.tick_ms == 10);
+    CHECK(scheduler.ticks == 11);
+    CHECK(records[n_records - 1].time == (int64_t)k_ms_to_ticks_ceil64(110));
+    STBS_Stop(&scheduler);
+
+    // From a 15 ms task to a 10 ms one: the boundary at 15 ms is 1.5 ticks of 10 ms
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 15, 1) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    STBS_Dispatch(&scheduler);  // 0 ms
+    CHECK(add_task(&scheduler, 1, 10, 2) == 0);
+    CHECK(STBS_RemoveTask(&scheduler, names[0]) == 0);
+    STBS_Dispatch(&scheduler);  // 15 ms: boundary, t1
+    CHECK(scheduler.tick_ms == 10);
+    CHECK(scheduler.ticks == 1);
+    STBS_Dispatch(&scheduler);  // 25 ms
+    CHECK(scheduler.ticks == 2);
+    CHECK(records[n_records - 1].thread == &threads[1]);
+    CHECK(records[n_records - 1].time == (int64_t)k_ms_to_ticks_ceil64(25));
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A dispatcher that wakes up late skips the missed ticks, or catches up on them
+static int test_late_wakeup(void) {
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    STBS_Dispatch(&scheduler);  // 0 ms
+    stbs_host_set_time(k_ms_to_ticks_ceil64(45));
+    STBS_Dispatch(&scheduler);  // ticks 1..3 are gone, tick 4 released late
+    CHECK(scheduler.missed_ticks == 3);
+    CHECK(threads[0].wakeups == 2);
+    STBS_Dispatch(&scheduler);
+    CHECK(k_uptime_ticks() == (int64_t)k_ms_to_ticks_ceil64(50));
+
+    STBS_SetTickPolicy(&scheduler, STBS_TICK_CATCHUP);
+    stbs_host_set_time(k_ms_to_ticks_ceil64(85));
+    for (int i = 0; i < 3; i++) {
+        STBS_Dispatch(&scheduler);  // ticks 6..8 back-to-back
+    }
+    CHECK(threads[0].wakeups == 6);
+    CHECK(k_uptime_ticks() == (int64_t)k_ms_to_ticks_ceil64(85));
+    STBS_Dispatch(&scheduler);      // tick 9 is on time again
+    CHECK(k_uptime_ticks() == (int64_t)k_ms_to_ticks_ceil64(90));
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// Job of a callback task: recorded like a wakeup of the thread passed as context
+static void callback_job(void* ctx) {
+    record_wakeup(ctx);
+}
+
+// Job that takes 3 ms of virtual time
+static void slow_job(void* ctx) {
+    record_wakeup(ctx);
+    stbs_host_set_time(k_uptime_ticks() + k_ms_to_ticks_ceil64(3));
+}
+
+// Callback tasks run inside the dispatch pass, ahead of the thread tasks released in
+// the same tick and in priority order among themselves; their jobs have statistics and
+// deadlines like managed threads, and they delay every thread task in the analysis
+static int test_callback(void) {
+    STBS scheduler;
+    STBS_TaskStats stats;
+    STBS_Analysis analysis;
+    Task t;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 0) == 0);
+    CHECK(Create_CallbackTask(&t, 20, 5, names[1], callback_job, &threads[1]) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(Create_CallbackTaskWCET(&t, 10, 2, names[2], slow_job, &threads[2], 0, 2) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(Create_CallbackTask(&t, 10, 1, names[3], NULL, NULL) == -1);
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    STBS_Dispatch(&scheduler);  // 0 ms: t2, t1 run, t0 is woken up
+    CHECK(n_records == 3);
+    CHECK(records[0].thread == &threads[2]);
+    CHECK(records[1].thread == &threads[1]);
+    CHECK(records[2].thread == &threads[0]);
+    CHECK(records[1].time == (int64_t)k_ms_to_ticks_ceil64(3));   // after the slow job
+
+    for (int i = 0; i < 9; i++) {
+        STBS_Dispatch(&scheduler);  // 10 .. 90 ms
+    }
+    uint32_t jobs[3] = {0};
+    for (uint32_t i = 0; i < n_records; i++) {
+        jobs[records[i].thread - threads]++;
+    }
+    CHECK(jobs[0] == 10 && jobs[1] == 5 && jobs[2] == 10);
+    CHECK(threads[0].wakeups == 10);
+    CHECK(threads[1].wakeups == 0 && threads[2].wakeups == 0);    // no thread involved
+
+    // Every job of t2 takes 3 ms against a 2 ms deadline
+    CHECK(STBS_GetTaskStats(&scheduler, names[2], &stats) == 0);
+    CHECK(stats.activations == 10);
+    CHECK(stats.deadline_misses == 10);
+    CHECK(stats.overruns == 0);
+    CHECK(STBS_GetTaskStats(&scheduler, names[1], &stats) == 0);
+    CHECK(stats.deadline_misses == 0);
+#if STBS_STATS
+    CHECK(stats.response.count == 5);
+    CHECK(stats.jitter.count == 5);
+#endif
+    STBS_Stop(&scheduler);
+
+    // A callback with a lower priority value still delays a thread task
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(Create_TaskWCET(&t, 10, 0, names[0], &threads[0], 5000, 6) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(Create_CallbackTaskWCET(&t, 10, 9, names[1], callback_job, &threads[1], 2000, 0) == 0);
+    CHECK(STBS_Analyse(&scheduler, &t, &analysis) == -2);
+    CHECK(analysis.failed_task == names[0]);
+    CHECK(Create_TaskWCET(&t, 10, 9, names[1], &threads[1], 2000, 0) == 0);
+    CHECK(STBS_Analyse(&scheduler, &t, &analysis) == 0);
+    return 0;
+}
+
+// Aperiodic jobs submitted between ticks run in the server's next releases, as many
+// as the budget covers; a full queue and jobs longer than the budget are rejected
+static int test_server(void) {
+    static STBS_AperiodicJob queue[4];
+    STBS_Server server;
+    STBS_ServerStats stats;
+    STBS scheduler;
+    Task t;
+
+    sim_reset();
+    CHECK(STBS_ServerInit(&server, queue, 3, 1000) == -1);
+    CHECK(STBS_ServerInit(&server, queue, ARRAY_SIZE(queue), 1000) == 0);
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(Create_ServerTask(&t, 10, 0, names[1], &server) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(scheduler.analysis.utilisation_permille == 100);
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    STBS_Dispatch(&scheduler);  // 0 ms: nothing queued yet
+    CHECK(n_records == 1);
+
+    stbs_host_set_time(k_ms_to_ticks_ceil64(5));
+    for (int i = 2; i < 5; i++) {
+        CHECK(STBS_Submit(&server, callback_job, &threads[i], 400) == 0);
+    }
+    CHECK(STBS_Submit(&server, callback_job, &threads[5], 1001) == -2);
+    CHECK(STBS_Submit(&server, callback_job, &threads[5], 0) == 0);
+    CHECK(STBS_Submit(&server, callback_job, &threads[6], 0) == -1);
+
+    STBS_Dispatch(&scheduler);  // 10 ms: two jobs of 400 us fit the budget, ahead of t0
+    CHECK(n_records == 4);
+    CHECK(records[1].thread == &threads[2]);
+    CHECK(records[2].thread == &threads[3]);
+    CHECK(records[3].thread == &threads[0]);
+    STBS_Dispatch(&scheduler);  // 20 ms: the rest
+    CHECK(n_records == 7);
+    CHECK(records[4].thread == &threads[4]);
+    CHECK(records[5].thread == &threads[5]);
+    CHECK(records[4].time == (int64_t)k_ms_to_ticks_ceil64(20));
+
+    STBS_GetServerStats(&server, &stats);
+    CHECK(stats.queued == 0);
+    CHECK(stats.submitted == 4);
+    CHECK(stats.completed == 4);
+    CHECK(stats.rejected == 2);
+    CHECK(stats.overruns == 0);
+#if STBS_STATS
+    CHECK(stats.response.count == 4);
+    CHECK(stats.response.min_us >= 4900 && stats.response.min_us <= 5100);
+    CHECK(stats.response.max_us >= 14900 && stats.response.max_us <= 15100);
+#endif
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+static int add_task_wcet(STBS* scheduler, int i, uint32_t period_ms, uint8_t priority,
+                         uint32_t wcet_us) {
+    Task t;
+    Create_TaskWCET(&t, period_ms, priority, names[i], &threads[i], wcet_us, 0);
+    return STBS_AddTask(scheduler, &t);
+}
+
+// A task with an offset is released that long after every macrocycle start; the tick
+// shrinks to fit the offset
+static int test_offset(void) {
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 1, 20, 2) == 0);
+    CHECK(STBS_SetOffset(&scheduler, names[1], 20) == -1);
+    CHECK(STBS_SetOffset(&scheduler, names[1], 5) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.tick_ms == 5);
+    CHECK(scheduler.n_events == 3);     // ticks 0, 1 and 2 of 4
+
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(45)) {
+        STBS_Dispatch(&scheduler);
+    }
+    static const int64_t t1_ms[] = {5, 25, 45};
+    int n = 0;
+    for (uint32_t i = 0; i < n_records; i++) {
+        if (records[i].thread == &threads[1]) {
+            CHECK(records[i].time == (int64_t)k_ms_to_ticks_ceil64(t1_ms[n]));
+            n++;
+        }
+    }
+    CHECK(n == 3);
+    CHECK(threads[0].wakeups == 5);     // 0 .. 40 ms
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// Non-harmonic periods give a 1 ms tick that no single release fits in. Thread tasks are
+// admitted on their response times; callbacks must be done by the next release.
+static int test_non_harmonic(void) {
+    STBS scheduler;
+    STBS_Analysis analysis;
+    Task t;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task_wcet(&scheduler, 0, 50, 0, 5000) == 0);
+    CHECK(add_task_wcet(&scheduler, 1, 51, 1, 5000) == 0);
+    CHECK(scheduler.analysis.tick_ms == 1);
+    CHECK(scheduler.analysis.peak_tick_load_us == 10000);
+    CHECK(scheduler.analysis.max_response_us == 10000);
+
+    // 1 ms between the releases at 2499 and 2500 ms
+    CHECK(Create_CallbackTaskWCET(&t, 51, 2, names[2], callback_job, &threads[2], 1100, 0) == 0);
+    CHECK(STBS_Analyse(&scheduler, &t, &analysis) == -2);
+    CHECK(Create_CallbackTaskWCET(&t, 51, 2, names[2], callback_job, &threads[2], 900, 0) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+
+    CHECK(STBS_Start(&scheduler) == 0);
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(102)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(threads[0].wakeups == 3);     // 0, 50, 100 ms
+    CHECK(threads[1].wakeups == 3);     // 0, 51, 102 ms
+    CHECK(records[n_records - 1].time == (int64_t)k_ms_to_ticks_ceil64(102));
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// The optimiser spreads the releases of tasks with WCETs over the macrocycle, and a
+// task added while running is placed around the others, which keep their offsets
+static int test_auto_offset(void) {
+    uint32_t load[4];
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 8) == 0);
+    for (int i = 0; i < 4; i++) {
+        CHECK(add_task_wcet(&scheduler, i, 20, i, 1000) == 0);
+    }
+    CHECK(add_task_wcet(&scheduler, 4, 10, 4, 500) == 0);
+    CHECK(scheduler.analysis.peak_tick_load_us == 4500);
+
+    STBS_SetAutoOffsets(&scheduler, true);
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.analysis.peak_tick_load_us == 2500);
+    CHECK(STBS_GetLoadProfile(&scheduler, load, ARRAY_SIZE(load)) == 2);
+    CHECK(load[0] == 2500 && load[1] == 2500);
+    CHECK(scheduler.task_list[0].offset_ms == 0);
+    CHECK(scheduler.task_list[1].offset_ms == 10);
+
+    STBS_Dispatch(&scheduler);  // 0 ms: t0, t2, t4
+    STBS_Dispatch(&scheduler);  // 10 ms: t1, t3, t4
+    CHECK(n_records == 6);
+    CHECK(records[3].thread == &threads[1]);
+    CHECK(records[3].time == (int64_t)k_ms_to_ticks_ceil64(10));
+
+    // A 40 ms task goes to the least loaded of its four ticks; the others stay
+    CHECK(add_task_wcet(&scheduler, 5, 40, 5, 700) == 0);
+    CHECK(scheduler.task_list[0].offset_ms == 0);
+    CHECK(scheduler.task_list[1].offset_ms == 10);
+    CHECK(scheduler.task_list[5].offset_ms == 0);
+    CHECK(scheduler.analysis.peak_tick_load_us == 3200);
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(80)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(STBS_GetLoadProfile(&scheduler, load, ARRAY_SIZE(load)) == 4);
+    CHECK(load[0] == 3200 && load[1] == 2500 && load[2] == 2500 && load[3] == 2500);
+    CHECK(threads[5].wakeups == 2);     // 40 and 80 ms
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+static int add_callback_wcet(STBS* scheduler, int i, uint32_t period_ms, uint8_t priority,
+                             uint32_t wcet_us) {
+    Task t;
+    Create_CallbackTaskWCET(&t, period_ms, priority, names[i], callback_job, &threads[i], wcet_us, 0);
+    return STBS_AddTask(scheduler, &t);
+}
+
+// Offsets the optimiser cannot place, or whose placement fails the analysis, stay as they
+// were. With a macrocycle longer than STBS_MAX_OFFSET_TICKS, the offset given to t1
+// survives STBS_Start. Spreading t1 (40 ms thread) away from the callbacks at 0 ms
+// releases it at 10 ms, before the 13 ms they take, so it keeps offset 0.
+static int test_auto_offset_keep(void) {
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 7, 0) == 0);
+    CHECK(add_task(&scheduler, 1, 1031, 1) == 0);
+    CHECK(STBS_SetOffset(&scheduler, names[1], 3) == 0);
+
+    STBS_SetAutoOffsets(&scheduler, true);
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.task_list[1].offset_ms == 3);
+    CHECK(scheduler.tick_ms == 1);
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(1000)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(threads[1].wakeups == 1);     // 3 ms
+    CHECK(records[1].thread == &threads[1]);
+    CHECK(records[1].time == (int64_t)k_ms_to_ticks_ceil64(3));
+    STBS_Stop(&scheduler);
+
+    // Placement of an added task
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_callback_wcet(&scheduler, 0, 30, 0, 5000) == 0);
+    CHECK(add_callback_wcet(&scheduler, 2, 40, 2, 8000) == 0);
+    STBS_SetAutoOffsets(&scheduler, true);
+    CHECK(add_task_wcet(&scheduler, 1, 40, 1, 3000) == 0);
+    CHECK(scheduler.task_list[2].offset_ms == 0);
+    CHECK(scheduler.analysis.schedulable);
+
+    // Placement of the whole set: the offsets the tasks got when added stay
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    STBS_SetAutoOffsets(&scheduler, true);
+    CHECK(add_callback_wcet(&scheduler, 0, 30, 0, 5000) == 0);
+    CHECK(add_task_wcet(&scheduler, 1, 40, 1, 3000) == 0);
+    CHECK(add_callback_wcet(&scheduler, 2, 40, 2, 8000) == 0);
+    CHECK(scheduler.task_list[1].offset_ms == 0);
+    CHECK(scheduler.task_list[2].offset_ms == 10);
+    CHECK(STBS_Start(&scheduler) == 0);
+    CHECK(scheduler.task_list[1].offset_ms == 0);
+    CHECK(scheduler.task_list[2].offset_ms == 10);
+    CHECK(scheduler.analysis.schedulable);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// Input task writes a sample, output task publishes the latest one it sees
+static uint32_t input_sample;
+static uint32_t output_sample;
+
+static void input_job(void* ctx) {
+    record_wakeup(ctx);
+    input_sample++;
+}
+
+static void output_job(void* ctx) {
+    record_wakeup(ctx);
+    output_sample = input_sample;
+}
+
+// A consumer runs right after its producer's job, in the same tick, even with a higher
+// priority; without the dependency it sees the previous period's sample
+static int test_dependency(void) {
+    STBS scheduler;
+    STBS_TaskStats stats;
+    Task t;
+
+    sim_reset();
+    input_sample = 0;
+    output_sample = 0;
+    CHECK(STBS_Init(&scheduler, 100, 4) == 0);
+    CHECK(Create_CallbackTask(&t, 100, 5, names[0], input_job, &threads[0]) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(Create_CallbackTask(&t, 100, 1, names[1], output_job, &threads[1]) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(add_task(&scheduler, 2, 100, 0) == 0);
+    CHECK(add_task(&scheduler, 3, 50, 0) == 0);
+
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[3]) == -1);   // periods differ
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[0]) == -1);
+    CHECK(STBS_AddDependency(&scheduler, names[2], names[1]) == -1);   // callback after a thread
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    STBS_Dispatch(&scheduler);  // 0 ms: output runs before input
+    CHECK(output_sample == 0 && input_sample == 1);
+
+    // Output and then t2 follow input from the next macrocycle on
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[1]) == 0);
+    CHECK(STBS_AddDependency(&scheduler, names[1], names[2]) == 0);
+    CHECK(STBS_AddDependency(&scheduler, names[2], names[0]) == -1);   // cycle
+    CHECK(STBS_AddDependency(&scheduler, names[3], names[1]) == -1);   // one producer
+    STBS_Dispatch(&scheduler);  // 50 ms: t3
+    CHECK(threads[2].wakeups == 1);
+
+    n_records = 0;
+    STBS_Dispatch(&scheduler);  // 100 ms: boundary, input, output, t2, then t3
+    CHECK(n_records == 4);
+    CHECK(records[0].thread == &threads[0]);
+    CHECK(records[1].thread == &threads[1]);
+    CHECK(records[2].thread == &threads[2]);
+    CHECK(records[3].thread == &threads[3]);
+    CHECK(output_sample == input_sample);
+    CHECK(threads[2].wakeups == 2);
+
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(1000)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(output_sample == input_sample && input_sample == 11);
+    CHECK(threads[2].wakeups == 11);
+    CHECK(STBS_GetTaskStats(&scheduler, names[1], &stats) == 0);
+    CHECK(stats.activations == 11);
+    CHECK(stats.deadline_misses == 0);
+#if STBS_STATS
+    CHECK(stats.end_to_end.count == 10);
+    CHECK(stats.end_to_end.max_us < 1000);  // a period (100 ms) without the chain
+#endif
+
+    // Without its producer, t2 is time-triggered again from the next macrocycle on
+    CHECK(STBS_RemoveTask(&scheduler, names[1]) == 0);
+    CHECK(scheduler.task_list[2].producer == 1);    // until the boundary
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(1200)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(threads[2].wakeups == 13);
+    CHECK(STBS_RemoveDependency(&scheduler, names[2]) == -1);
+    CHECK(scheduler.task_list[2].producer == -1);
+    CHECK(scheduler.task_list[0].n_consumers == 0);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A consumer whose link is removed keeps following its producer up to the macrocycle
+// boundary, then runs from the table: with 10 ms tasks in a 100 ms macrocycle it runs
+// in every tick of the switch
+static int test_unchain(void) {
+    STBS scheduler;
+    Task t;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 3) == 0);
+    CHECK(Create_CallbackTask(&t, 10, 1, names[0], callback_job, &threads[0]) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(Create_CallbackTask(&t, 10, 2, names[1], callback_job, &threads[1]) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(add_task(&scheduler, 2, 100, 0) == 0);
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[1]) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(100)) {
+        STBS_Dispatch(&scheduler);
+    }
+    CHECK(STBS_RemoveDependency(&scheduler, names[1]) == 0);
+    CHECK(STBS_RemoveDependency(&scheduler, names[1]) == -1);  // already on its way out
+    n_records = 0;
+    while (k_uptime_ticks() < (int64_t)k_ms_to_ticks_ceil64(300)) {
+        STBS_Dispatch(&scheduler);
+    }
+
+    // 110 .. 300 ms: t1 right after t0 until 190 ms, then from the table
+    uint32_t runs[2] = {0, 0};
+    for (uint32_t i = 0; i < n_records; i++) {
+        if (records[i].thread == &threads[0] || records[i].thread == &threads[1])
+            runs[records[i].thread - threads]++;
+    }
+    CHECK(runs[0] == 20 && runs[1] == 20);
+    CHECK(scheduler.task_list[1].activations == 31);  // 0 .. 300 ms
+    CHECK(STBS_RemoveDependency(&scheduler, names[1]) == -1);
+    CHECK(scheduler.task_list[1].producer == -1 && scheduler.task_list[0].n_consumers == 0);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A consumer's deadline runs from its producer's release: t1 alone answers in 6 ms,
+// within its 7 ms deadline, but only 3 + 6 ms after t0 is released
+static int test_chain_admission(void) {
+    STBS scheduler;
+    Task t;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task_wcet(&scheduler, 0, 10, 0, 3000) == 0);
+    CHECK(Create_TaskWCET(&t, 10, 1, names[1], &threads[1], 3000, 7) == 0);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    CHECK(add_task_wcet(&scheduler, 2, 10, 2, 1000) == 0);
+    CHECK(scheduler.task_list[1].response_bound_us == 6000);
+
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[1]) == -2);
+    CHECK(scheduler.task_list[1].producer == -1 && scheduler.task_list[0].n_consumers == 0);
+    CHECK(scheduler.task_list[1].response_bound_us == 6000);
+
+    // t2 answers in 7 ms, 10 ms after t0's release: just in time
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[2]) == 0);
+    CHECK(scheduler.task_list[2].response_bound_us == 10000);
+    CHECK(scheduler.analysis.max_response_us == 10000);
+    CHECK(STBS_RemoveDependency(&scheduler, names[2]) == 0);
+    CHECK(scheduler.task_list[2].response_bound_us == 7000);
+
+    // A task of unknown WCET still waits for the work above it: 7 ms plus its own 1 us,
+    // too late once chained after t0
+    CHECK(add_task_wcet(&scheduler, 3, 10, 3, 0) == 0);
+    CHECK(scheduler.task_list[3].response_bound_us == 7001);
+    CHECK(STBS_AddDependency(&scheduler, names[0], names[3]) == -2);
+    return 0;
+}
+
+// Managed thread whose jobs start 1 ms late and take 3 ms: jitter and response time of
+// every job, and the CPU load from the kernel's busy and idle time
+static int test_thread_stats(void) {
+    STBS scheduler;
+    STBS_TaskStats task_stats;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 2) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);
+    CHECK(!thread_running(&scheduler, 0));
+
+    for (int k = 0; k < 10; k++) {
+        STBS_Dispatch(&scheduler);
+        stbs_host_set_time(k_uptime_ticks() + k_ms_to_ticks_ceil64(1));
+        thread_wait(&scheduler, 0);     // job starts
+        CHECK(thread_running(&scheduler, 0));
+        stbs_host_set_time(k_uptime_ticks() + k_ms_to_ticks_ceil64(3));
+        thread_wait(&scheduler, 0);     // job completes, nothing released yet
+        CHECK(!thread_running(&scheduler, 0));
+    }
+
+    CHECK(STBS_GetTaskStats(&scheduler, names[0], &task_stats) == 0);
+    CHECK(task_stats.activations == 10);
+    CHECK(task_stats.overruns == 0 && task_stats.deadline_misses == 0);
+#if STBS_STATS
+    CHECK(task_stats.jitter.count == 10);
+    CHECK(task_stats.jitter.min_us >= 1000 && task_stats.jitter.max_us <= 1100);
+    CHECK(task_stats.response.count == 10);
+#endif
+#if STBS_CPU_LOAD
+    // 4 ms of every 10 ms busy, up to the end of the last job at 94 ms
+    STBS_Stats stats;
+    STBS_GetStats(&scheduler, &stats);
+    CHECK(stats.load_permille >= 420 && stats.load_permille <= 430);
+#endif
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+static uint32_t hook_events[2];    // per STBS_Event
+
+static void count_event(STBS* scheduler, Task* t, STBS_Event event) {
+    hook_events[event]++;
+}
+
+// Three releases during one long job: two are queued and started back-to-back, each
+// late against its own deadline, the third is dropped
+static int test_overrun_queue(void) {
+    STBS scheduler;
+    STBS_TaskStats task_stats;
+
+    sim_reset();
+    memset(hook_events, 0, sizeof(hook_events));
+    CHECK(STBS_Init(&scheduler, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(STBS_SetOverrunPolicy(&scheduler, names[0], STBS_OVERRUN_QUEUE, 2) == 0);
+    STBS_SetEventHook(&scheduler, count_event);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);
+
+    STBS_Dispatch(&scheduler);          // 0 ms
+    thread_wait(&scheduler, 0);
+    for (int k = 0; k < 3; k++) {
+        STBS_Dispatch(&scheduler);      // 10, 20, 30 ms: overruns
+    }
+    CHECK(scheduler.task_list[0].pending == 2);
+    CHECK(hook_events[STBS_EVENT_OVERRUN] == 3);
+
+    stbs_host_set_time(k_ms_to_ticks_ceil64(35));
+    thread_wait(&scheduler, 0);         // job of 0 ms ends, the one of 10 ms starts
+    CHECK(thread_running(&scheduler, 0));
+    CHECK(scheduler.task_list[0].pending == 1);
+    CHECK(scheduler.task_list[0].release_time == (int64_t)k_ms_to_ticks_ceil64(10));
+    thread_wait(&scheduler, 0);         // the one of 20 ms starts
+    CHECK(scheduler.task_list[0].pending == 0);
+    thread_wait(&scheduler, 0);         // the one of 20 ms ends, nothing left
+    CHECK(!thread_running(&scheduler, 0));
+    CHECK(hook_events[STBS_EVENT_DEADLINE_MISS] == 3);
+
+    STBS_Dispatch(&scheduler);          // 40 ms: back on time
+    thread_wait(&scheduler, 0);
+    CHECK(thread_running(&scheduler, 0));
+    thread_wait(&scheduler, 0);
+
+    CHECK(STBS_GetTaskStats(&scheduler, names[0], &task_stats) == 0);
+    CHECK(task_stats.activations == 5);
+    CHECK(task_stats.overruns == 3 && task_stats.skipped == 1);
+    CHECK(task_stats.deadline_misses == 3);
+#if STBS_STATS
+    CHECK(task_stats.response.count == 4);
+#endif
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A late job is lowered to the demotion priority once, keeps one release pending, and
+// gets its priority back when it completes
+static int test_overrun_demote(void) {
+    STBS scheduler;
+    STBS_TaskStats task_stats;
+
+    sim_reset();
+    memset(hook_events, 0, sizeof(hook_events));
+    threads[0].prio = 3;
+    CHECK(STBS_Init(&scheduler, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(STBS_SetOverrunPolicy(&scheduler, names[0], STBS_OVERRUN_DEMOTE, 9) == 0);
+    STBS_SetEventHook(&scheduler, count_event);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);
+
+    STBS_Dispatch(&scheduler);          // 0 ms
+    thread_wait(&scheduler, 0);
+    STBS_Dispatch(&scheduler);          // 10 ms: overrun, demoted
+    CHECK(threads[0].prio == 9);
+    CHECK(scheduler.task_list[0].pending == 1);
+    STBS_Dispatch(&scheduler);          // 20 ms: overrun, dropped
+    CHECK(threads[0].prio == 9);
+    CHECK(scheduler.task_list[0].pending == 1);
+
+    stbs_host_set_time(k_ms_to_ticks_ceil64(25));
+    thread_wait(&scheduler, 0);         // late job ends, the pending one starts
+    CHECK(threads[0].prio == 3);
+    CHECK(thread_running(&scheduler, 0));
+    CHECK(scheduler.task_list[0].pending == 0);
+    thread_wait(&scheduler, 0);
+    CHECK(!thread_running(&scheduler, 0));
+
+    CHECK(STBS_GetTaskStats(&scheduler, names[0], &task_stats) == 0);
+    CHECK(task_stats.overruns == 2 && task_stats.skipped == 1);
+    CHECK(task_stats.deadline_misses == 2);     // the jobs of 0 and 10 ms
+    CHECK(hook_events[STBS_EVENT_OVERRUN] == 2);
+    CHECK(hook_events[STBS_EVENT_DEADLINE_MISS] == 2);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// A managed job that completes after its constrained deadline, but before its next
+// release, is a deadline miss without an overrun
+static int test_deadline_miss(void) {
+    STBS scheduler;
+    STBS_TaskStats task_stats;
+    Task t;
+
+    sim_reset();
+    memset(hook_events, 0, sizeof(hook_events));
+    CHECK(STBS_Init(&scheduler, 10, 1) == 0);
+    Create_TaskWCET(&t, 10, 1, names[0], &threads[0], 1000, 5);
+    CHECK(STBS_AddTask(&scheduler, &t) == 0);
+    STBS_SetEventHook(&scheduler, count_event);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);
+
+    for (int k = 0; k < 4; k++) {
+        STBS_Dispatch(&scheduler);
+        thread_wait(&scheduler, 0);
+        // every other job ends 6 ms after its release
+        stbs_host_set_time(k_uptime_ticks() + k_ms_to_ticks_ceil64((k % 2) ? 6 : 4));
+        thread_wait(&scheduler, 0);
+    }
+
+    CHECK(STBS_GetTaskStats(&scheduler, names[0], &task_stats) == 0);
+    CHECK(task_stats.activations == 4);
+    CHECK(task_stats.overruns == 0);
+    CHECK(task_stats.deadline_misses == 2);
+    CHECK(hook_events[STBS_EVENT_DEADLINE_MISS] == 2);
+    CHECK(hook_events[STBS_EVENT_OVERRUN] == 0);
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+// The slot of a removed task keeps serving its thread until the job in progress ends
+// and is taken by a new task only once no thread waits on its semaphore
+static int test_retired_slot(void) {
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 3) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 1, 10, 2) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);
+    thread_wait(&scheduler, 1);
+    STBS_Dispatch(&scheduler);          // 0 ms: t0, t1 released
+    thread_wait(&scheduler, 0);
+    CHECK(thread_running(&scheduler, 0));
+
+    // t1 is removed with its release not taken yet; its slot stays dispatched
+    CHECK(STBS_RemoveTask(&scheduler, names[1]) == 0);
+    CHECK(add_task(&scheduler, 2, 10, 3) == 0);
+    CHECK(scheduler.task_list[2].tid == &threads[2]);
+    CHECK(add_task(&scheduler, 3, 10, 4) == -1);    // no free slot
+    thread_wait(&scheduler, 1);         // takes the release made before the removal
+    CHECK(scheduler.task_list[1].state == STBS_TASK_RUNNING);
+    CHECK(!scheduler.task_list[1].waiting);
+
+    STBS_Dispatch(&scheduler);          // 10 ms: boundary, t1 is gone
+    CHECK(threads[1].wakeups == 0 && scheduler.task_list[1].activations == 1);
+    thread_wait(&scheduler, 1);         // ends the job and leaves the slot
+    CHECK(scheduler.task_list[1].state == STBS_TASK_COMPLETED);
+    CHECK(add_task(&scheduler, 3, 10, 4) == 0);
+    CHECK(scheduler.task_list[1].tid == &threads[3]);
+
+    // A thread removed while waiting is woken at the boundary and only then lets go
+    thread_wait(&scheduler, 2);
+    CHECK(scheduler.task_list[2].waiting);
+    CHECK(STBS_RemoveTask(&scheduler, names[2]) == 0);
+    STBS_Dispatch(&scheduler);          // 20 ms: boundary, t2 is gone
+    CHECK(add_task(&scheduler, 4, 10, 5) == -1);
+    thread_wait(&scheduler, 2);
+    CHECK(!scheduler.task_list[2].waiting);
+    CHECK(add_task(&scheduler, 4, 10, 5) == 0);
+    CHECK(scheduler.task_list[2].tid == &threads[4]);
+
+    // A thread that left its slot can be scheduled again
+    thread_wait(&scheduler, 0);         // t0 ends its first job
+    CHECK(STBS_RemoveTask(&scheduler, names[0]) == 0);
+    STBS_Dispatch(&scheduler);          // 30 ms: boundary, t0 is gone
+    thread_wait(&scheduler, 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(scheduler.task_list[0].retire_gen == 0);
+    thread_wait(&scheduler, 0);
+    STBS_Dispatch(&scheduler);          // 40 ms: t0 back in the set
+    thread_wait(&scheduler, 0);
+    CHECK(thread_running(&scheduler, 0));
+    STBS_Stop(&scheduler);
+    return 0;
+}
+
+static const char* trace_file;     // optional second argument of the trace test
+
+#if STBS_TRACE
+typedef struct {
+    uint8_t data[8192];
+    size_t len;
+} TraceBuffer;
+
+static void trace_write(const void* data, size_t len, void* ctx) {
+    TraceBuffer* buffer = ctx;
+    if (buffer->len + len <= sizeof(buffer->data)) {
+        memcpy(&buffer->data[buffer->len], data, len);
+    }
+    buffer->len += len;
+}
+
+// Trace of a few ticks with a managed task, then of a run long enough to wrap the ring.
+// The dump of the second run is written to the file given after the test name, if any,
+// for host/tools/stbs_trace.py.
+static int test_trace(void) {
+    static TraceBuffer buffer;
+    STBS_TraceHeader header;
+    STBS_TraceRecord r;
+    STBS scheduler;
+
+    sim_reset();
+    CHECK(STBS_Init(&scheduler, 10, 4) == 0);
+    CHECK(add_task(&scheduler, 0, 10, 1) == 0);
+    CHECK(add_task(&scheduler, 1, 20, 2) == 0);
+    CHECK(STBS_Start(&scheduler) == 0);
+    thread_wait(&scheduler, 0);         // t0 waits for its first release
+    STBS_TraceClear();
+
+    STBS_Dispatch(&scheduler);          // 0 ms: t0, t1
+    thread_wait(&scheduler, 0);         // t0 starts its first job
+
+    buffer.len = 0;
+    STBS_TraceDump(&scheduler, trace_write, &buffer);
+    CHECK(buffer.len == sizeof(header) + 2 * (2 + 2) + 4 * sizeof(r));
+    memcpy(&header, buffer.data, sizeof(header));
+    CHECK(memcmp(header.magic, "STBT", 4) == 0);
+    CHECK(header.version == 1);
+    CHECK(header.n_tasks == 2);
+    CHECK(header.cycles_per_sec == sys_clock_hw_cycles_per_sec());
+    CHECK(header.n_records == 4);
+    CHECK(header.lost == 0);
+
+    const uint8_t* names_start = &buffer.data[sizeof(header)];
+    CHECK(names_start[0] == 0 && names_start[1] == 2 && memcmp(&names_start[2], "t0", 2) == 0);
+    CHECK(names_start[4] == 1 && names_start[5] == 2 && memcmp(&names_start[6], "t1", 2) == 0);
+
+    static const uint8_t types[] = {STBS_TRACE_TICK, STBS_TRACE_RELEASE, STBS_TRACE_RELEASE,
+                                    STBS_TRACE_START};
+    static const uint8_t tasks[] = {STBS_TRACE_NO_TASK, 0, 1, 0};
+    const uint8_t* records_start = names_start + 8;
+    for (int i = 0; i < 4; i++) {
+        memcpy(&r, &records_start[i * sizeof(r)], sizeof(r));
+        CHECK(r.type == types[i]);
+        CHECK(r.task == tasks[i]);
+    }
+    memcpy(&r, &records_start[3 * sizeof(r)], sizeof(r));
+    CHECK(r.arg == 1);
+
+    // The managed task never completes again, so every later release of t0 is an overrun
+    for (int i = 0; i < 200; i++) {
+        STBS_Dispatch(&scheduler);
+    }
+    buffer.len = 0;
+    STBS_TraceDump(&scheduler, trace_write, &buffer);
+    memcpy(&header, buffer.data, sizeof(header));
+    CHECK(header.n_records == STBS_TRACE_SIZE);
+    CHECK(header.lost == 4 + 200 * 3 + 100 - STBS_TRACE_SIZE);
+
+    // Oldest first, and the ring ends with the release of t1 at 2000 ms
+    records_start = &buffer.data[sizeof(header) + 8];
+    uint32_t previous = 0;
+    for (int i = 0; i < STBS_TRACE_SIZE; i++) {
+        memcpy(&r, &records_start[i * sizeof(r)], sizeof(r));
+        CHECK(i == 0 || (int32_t)(r.cycles - previous) >= 0);
+        previous = r.cycles;
+    }
+    CHECK(r.type == STBS_TRACE_RELEASE && r.task == 1 && r.arg == 101);
+
+    if (trace_file != NULL) {
+        FILE* f = fopen(trace_file, "wb");
+        CHECK(f != NULL);
+        fwrite(buffer.data, 1, buffer.len, f);
+        fclose(f);
+    }
+    STBS_Stop(&scheduler);
+    return 0;
+}
+#else
+// Nothing is recorded with STBS_TRACE set to 0
+static int test_trace(void) {
+    return 0;
+}
+#endif
+
+int main(int argc, char** argv) {
+    static const struct {
+        const char* name;
+        int (*run)(void);
+    } tests[] = {
+        {"sequence", test_sequence},
+        {"long_run", test_long_run},
+        {"mode_change", test_mode_change},
+        {"mode_change_tick", test_mode_change_tick},
+        {"late_wakeup", test_late_wakeup},
+        {"trace", test_trace},
+        {"thread_stats", test_thread_stats},
+        {"overrun_queue", test_overrun_queue},
+        {"overrun_demote", test_overrun_demote},
+        {"deadline_miss", test_deadline_miss},
+        {"retired_slot", test_retired_slot},
+        {"callback", test_callback},
+        {"server", test_server},
+        {"offset", test_offset},
+        {"non_harmonic", test_non_harmonic},
+        {"auto_offset", test_auto_offset},
+        {"auto_offset_keep", test_auto_offset_keep},
+        {"dependency", test_dependency},
+        {"unchain", test_unchain},
+        {"chain_admission", test_chain_admission},
+    };
+
+    if (argc > 2)
+        trace_file = argv[2];
+
+    for (size_t i = 0; i < ARRAY_SIZE(tests); i++) {
+        if (argc < 2 || strcmp(argv[1], tests[i].name) == 0) {
+            if (tests[i].run() != 0) {
+                fprintf(stderr, "%s: FAILED\n", tests[i].name);
+                return 1;
+            }
+            printf("%s: passed\n", tests[i].name);
+        }
+    }
+    return 0;
+}
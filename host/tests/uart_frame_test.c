@@ -0,0 +1,195 @@
+#include "../../uart_frame.h"
+#include <stdio.h>
+#include <string.h>
+
+// Tests of the UART frame encoder and the byte-at-a-time parser
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+// Feeds bytes one at a time; counts frames and errors, keeps the last frame
+static int feed(uart_parser* parser, const uint8_t* data, size_t len, uart_frame* frame, int* errors) {
+    int frames = 0;
+    for (size_t i = 0; i < len; i++) {
+        uart_parse_result result = uart_parser_feed(parser, data[i], frame);
+        if (result == UART_PARSE_FRAME)
+            frames++;
+        else if (result == UART_PARSE_ERROR)
+            (*errors)++;
+    }
+    return frames;
+}
+
+static int test_crc(void) {
+    // CRC-16/CCITT-FALSE check value
+    CHECK(uart_crc16(0xFFFF, (const uint8_t*)"123456789", 9) == 0x29B1);
+    return 0;
+}
+
+static int test_text(void) {
+    char buffer[UART_TEXT_FRAME_SIZE];
+    char device_id, command, payload[MAX_PAYLOAD_SIZE + 1];
+
+    size_t len = build_uart_frame(buffer, sizeof(buffer), 'A', 'W', "0123456789");
+    CHECK(len == strlen(buffer));
+    CHECK(len == 3 + 10 + 4 + 1);
+    CHECK(buffer[0] == '!' && buffer[len - 1] == '#');
+    CHECK(interpret_uart_frame(buffer, &device_id, &command, payload));
+    CHECK(device_id == 'A' && command == 'W' && strcmp(payload, "0123456789") == 0);
+
+    CHECK(build_uart_frame(buffer, sizeof(buffer), 'A', 'W', "0123456789X") == 0);
+    CHECK(build_uart_frame(buffer, 8, 'A', 'W', "01") == 0);
+    CHECK(build_uart_frame(buffer, sizeof(buffer), 'A', 'W', "1#2") == 0);
+    CHECK(build_uart_frame(buffer, sizeof(buffer), 'A', 'W', "!1") == 0);
+    CHECK(build_uart_frame(buffer, sizeof(buffer), '!', 'W', "1") == 0);
+    CHECK(build_uart_frame(buffer, sizeof(buffer), 'A', '#', "1") == 0);
+
+    CHECK(build_uart_frame(buffer, sizeof(buffer), 'B', 'R', NULL) == 8);
+    CHECK(interpret_uart_frame(buffer, &device_id, &command, payload));
+    CHECK(command == 'R' && payload[0] == '\0');
+
+    // Any corrupted byte is caught by the CRC
+    len = build_uart_frame(buffer, sizeof(buffer), 'A', 'W', "1234");
+    for (size_t i = 1; i < len - 1; i++) {
+        char saved = buffer[i];
+        buffer[i] ^= 0x01;
+        CHECK(!interpret_uart_frame(buffer, &device_id, &command, payload));
+        buffer[i] = saved;
+    }
+    return 0;
+}
+
+static int test_binary(void) {
+    uint8_t buffer[UART_BIN_FRAME_SIZE];
+    uart_bin_writer writer;
+    uart_parser parser;
+    uart_frame frame;
+    int errors = 0;
+    const uint8_t inputs[4] = {1, 0, 1, 1};
+    const uint8_t outputs[4] = {0, 0, 1, 0};
+
+    uart_bin_begin(&writer, buffer, sizeof(buffer), 'A');
+    CHECK(uart_bin_add(&writer, 'I', inputs, sizeof(inputs)));
+    CHECK(uart_bin_add(&writer, 'O', outputs, sizeof(outputs)));
+    CHECK(uart_bin_add(&writer, 'S', NULL, 0));
+    size_t len = uart_bin_end(&writer);
+    CHECK(len == 3 + (2 + 4) * 2 + 2 + 2);
+
+    uart_parser_init(&parser);
+    CHECK(feed(&parser, buffer, len, &frame, &errors) == 1);
+    CHECK(errors == 0);
+    CHECK(frame.binary && frame.device_id == 'A' && frame.n_records == 3);
+    CHECK(frame.records[0].command == 'I' && frame.records[0].len == 4);
+    CHECK(memcmp(&frame.payload[frame.records[0].offset], inputs, 4) == 0);
+    CHECK(frame.records[1].command == 'O');
+    CHECK(memcmp(&frame.payload[frame.records[1].offset], outputs, 4) == 0);
+    CHECK(frame.records[2].command == 'S' && frame.records[2].len == 0);
+
+    // A flipped bit anywhere after the sync byte invalidates the frame
+    for (size_t i = 1; i < len; i++) {
+        buffer[i] ^= 0x10;
+        uart_parser_init(&parser);
+        errors = 0;
+        CHECK(feed(&parser, buffer, len, &frame, &errors) == 0);
+        buffer[i] ^= 0x10;
+    }
+
+    // Records beyond the payload limit are refused
+    uint8_t big[UART_MAX_FRAME_PAYLOAD] = {0};
+    uart_bin_begin(&writer, buffer, sizeof(buffer), 'A');
+    CHECK(!uart_bin_add(&writer, 'X', big, UART_MAX_FRAME_PAYLOAD - 1));
+    CHECK(uart_bin_end(&writer) == 0);
+    return 0;
+}
+
+// Frames mixed with noise, back-to-back, and split at every byte
+static int test_stream(void) {
+    uint8_t stream[256];
+    size_t len = 0;
+    uart_bin_writer writer;
+    uart_parser parser;
+    uart_frame frame;
+    int errors = 0;
+
+    memcpy(&stream[len], "noise\r\n", 7);
+    len += 7;
+    len += build_uart_frame((char*)&stream[len], sizeof(stream) - len, 'A', 'L', "1");
+    memcpy(&stream[len], "!A", 2);  // truncated frame, resynchronised by the next '!'
+    len += 2;
+    len += build_uart_frame((char*)&stream[len], sizeof(stream) - len, 'A', 'L', "0");
+    uart_bin_begin(&writer, &stream[len], sizeof(stream) - len, 'B');
+    uart_bin_add(&writer, 'O', "\x01\x02", 2);
+    len += uart_bin_end(&writer);
+
+    uart_parser_init(&parser);
+    CHECK(feed(&parser, stream, len, &frame, &errors) == 3);
+    CHECK(errors == 1);
+    CHECK(frame.binary && frame.device_id == 'B' && frame.payload[frame.records[0].offset + 1] == 2);
+    return 0;
+}
+
+// A binary frame cut short swallows the start of the next one; the parser finds the
+// sync byte of the next frame in what it dropped. A 0xA5 in the data is just data.
+static int test_resync(void) {
+    uint8_t stream[64];
+    size_t len = 0;
+    uart_bin_writer writer;
+    uart_parser parser;
+    uart_frame frame;
+    int errors = 0;
+
+    memcpy(&stream[len], "\xA5" "C\x08" "xyz", 6);     // 3 of 8 bytes of records
+    len += 6;
+    uart_bin_begin(&writer, &stream[len], sizeof(stream) - len, 'B');
+    uart_bin_add(&writer, 'O', "\x01\x02", 2);
+    len += uart_bin_end(&writer);
+
+    uart_parser_init(&parser);
+    CHECK(feed(&parser, stream, len, &frame, &errors) == 1);
+    CHECK(errors == 1);
+    CHECK(frame.binary && frame.device_id == 'B' && frame.n_records == 1);
+    CHECK(frame.payload[frame.records[0].offset] == 1);
+
+    // Sync byte repeated: taken as the device id, then its length is out of range
+    len = 0;
+    stream[len++] = UART_BIN_SYNC;
+    uart_bin_begin(&writer, &stream[len], sizeof(stream) - len, 'B');
+    uart_bin_add(&writer, 'O', "\xA5\xA5", 2);
+    len += uart_bin_end(&writer);
+
+    uart_parser_init(&parser);
+    errors = 0;
+    CHECK(feed(&parser, stream, len, &frame, &errors) == 1);
+    CHECK(errors == 1);
+    CHECK(frame.device_id == 'B' && frame.payload[frame.records[0].offset + 1] == 0xA5);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    static const struct {
+        const char* name;
+        int (*run)(void);
+    } tests[] = {
+        {"crc", test_crc},
+        {"text", test_text},
+        {"binary", test_binary},
+        {"stream", test_stream},
+        {"resync", test_resync},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], tests[i].name) == 0) {
+            if (tests[i].run() != 0) {
+                fprintf(stderr, "%s: FAILED\n", tests[i].name);
+                return 1;
+            }
+            printf("%s: passed\n", tests[i].name);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Converts an STBS trace dump (STBS_TraceDump) into Chrome trace JSON.
+
+    stbs_trace.py dump.bin > trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev. Each task is a row
+with one slice per job (START..FINISH); ticks, releases, overruns and deadline misses
+are instant events. Timestamps are microseconds since the first record.
+"""
+
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<4sHHIII")
+RECORD = struct.Struct("<IBBH")
+
+TICK, RELEASE, START, FINISH, OVERRUN, DEADLINE_MISS = range(6)
+NO_TASK = 0xFF
+NAMES = {TICK: "tick", RELEASE: "release", START: "start", FINISH: "finish",
+         OVERRUN: "overrun", DEADLINE_MISS: "deadline miss"}
+
+
+def decode(data):
+    magic, version, n_tasks, cycles_per_sec, n_records, lost = HEADER.unpack_from(data)
+    if magic != b"STBT" or version != 1:
+        raise ValueError("not an STBS trace dump (version 1)")
+    pos = HEADER.size
+
+    tasks = {}
+    for _ in range(n_tasks):
+        slot, length = data[pos], data[pos + 1]
+        tasks[slot] = data[pos + 2:pos + 2 + length].decode(errors="replace")
+        pos += 2 + length
+
+    records = []
+    for _ in range(n_records):
+        records.append(RECORD.unpack_from(data, pos))
+        pos += RECORD.size
+    return tasks, cycles_per_sec, lost, records
+
+
+def to_chrome(tasks, cycles_per_sec, lost, records):
+    events = [{"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "STBS"}},
+              {"name": "thread_name", "ph": "M", "pid": 0, "tid": NO_TASK,
+               "args": {"name": "dispatcher"}}]
+    for slot, name in sorted(tasks.items()):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": slot,
+                       "args": {"name": name}})
+        events.append({"name": "thread_sort_index", "ph": "M", "pid": 0, "tid": slot,
+                       "args": {"sort_index": slot}})
+
+    # The 32-bit cycle counter wraps; records are in order, so unwrap by differences
+    cycles = 0
+    previous = records[0][0] if records else 0
+    open_jobs = set()
+    for raw, kind, task, arg in records:
+        cycles += (raw - previous) & 0xFFFFFFFF
+        previous = raw
+        ts = cycles * 1e6 / cycles_per_sec
+        name = tasks.get(task, "dispatcher" if task == NO_TASK else "slot %d" % task)
+
+        if kind == START:
+            events.append({"name": name, "ph": "B", "pid": 0, "tid": task, "ts": ts,
+                           "args": {"activation": arg}})
+            open_jobs.add(task)
+        elif kind == FINISH:
+            # a job started before the oldest record has no begin event
+            if task in open_jobs:
+                events.append({"name": name, "ph": "E", "pid": 0, "tid": task, "ts": ts})
+                open_jobs.discard(task)
+        else:
+            event = {"name": NAMES.get(kind, "type %d" % kind), "ph": "i", "s": "t",
+                     "pid": 0, "tid": task, "ts": ts}
+            event["args"] = {"tick" if kind == TICK else "activation": arg}
+            events.append(event)
+
+    return {"traceEvents": events, "displayTimeUnit": "ms",
+            "otherData": {"lost_records": lost}}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        tasks, cycles_per_sec, lost, records = decode(f.read())
+    if lost:
+        print("%d older records were overwritten" % lost, file=sys.stderr)
+    json.dump(to_chrome(tasks, cycles_per_sec, lost, records), sys.stdout, indent=1)
+
+
+if __name__ == "__main__":
+    main()
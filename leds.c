@@ -3,44 +3,121 @@
 
 LOG_MODULE_REGISTER(led_control);
 
-// Definir os LEDs (pinos GPIO)
-static const struct gpio_dt_spec led0 = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led0), gpios, {0});
-static const struct gpio_dt_spec led1 = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led1), gpios, {0});
-static const struct gpio_dt_spec led2 = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led2), gpios, {0});
-static const struct gpio_dt_spec led3 = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led3), gpios, {0});
+// Definir os LEDs (pinos GPIO) a partir dos aliases led<i> que existem no devicetree
+#define LED_SPEC(i, _)                                                  \
+    COND_CODE_1(DT_NODE_EXISTS(DT_ALIAS(led##i)),                       \
+                (GPIO_DT_SPEC_GET(DT_ALIAS(led##i), gpios),), ())
+
+static const struct gpio_dt_spec leds[] = {
+    LISTIFY(LEDS_MAX_CHANNELS, LED_SPEC, ())
+};
+
+#define LEDS_COUNT ARRAY_SIZE(leds)
+
+BUILD_ASSERT(LEDS_COUNT <= 32, "Máscaras de LEDs com 32 bits");
+
+// Portos GPIO usados pelos LEDs
+static const struct device *led_ports[LEDS_COUNT];
+static uint8_t n_ports;
+static uint8_t led_port[LEDS_COUNT];   // índice em led_ports de cada LED
+
+static uint32_t led_state;     // estado pretendido, um bit por LED
+static uint32_t led_written;   // estado escrito nos pinos
+static bool leds_ready;
 
 // Inicializar os LEDs
-void leds_init(void) {
-    if (!device_is_ready(led0.port) || !device_is_ready(led1.port) ||
-        !device_is_ready(led2.port) || !device_is_ready(led3.port)) {
-        LOG_ERR("GPIO device is not ready for LEDs\n");
-        return;
+int leds_init(void) {
+    n_ports = 0;
+    for (int i = 0; i < LEDS_COUNT; i++) {
+        if (!device_is_ready(leds[i].port)) {
+            LOG_ERR("GPIO device is not ready for LEDs\n");
+            return -ENODEV;
+        }
+
+        int err = gpio_pin_configure_dt(&leds[i], GPIO_OUTPUT_INACTIVE);  // Desliga os LEDs inicialmente
+        if (err != 0) {
+            LOG_ERR("Failed to configure LED %d (%d)\n", i, err);
+            return err;
+        }
+
+        // Agrupar os pinos por porto
+        int p = 0;
+        while (p < n_ports && led_ports[p] != leds[i].port) {
+            p++;
+        }
+        if (p == n_ports) {
+            led_ports[n_ports++] = leds[i].port;
+        }
+        led_port[i] = p;
     }
 
-    gpio_pin_configure_dt(&led0, GPIO_OUTPUT_INACTIVE);  // Desliga os LEDs inicialmente
-    gpio_pin_configure_dt(&led1, GPIO_OUTPUT_INACTIVE);
-    gpio_pin_configure_dt(&led2, GPIO_OUTPUT_INACTIVE);
-    gpio_pin_configure_dt(&led3, GPIO_OUTPUT_INACTIVE);
+    led_state = 0;
+    led_written = 0;
+    leds_ready = true;
+    LOG_INF("%d LEDs on %d GPIO ports have been initialized successfully\n", (int)LEDS_COUNT, n_ports);
+    return 0;
+}
 
-    LOG_INF("LEDs have been initialized successfully\n");
+int leds_count(void) {
+    return LEDS_COUNT;
 }
 
-// Definir o estado de um LED (acender/desligar)
+// Definir o estado de um LED (acender/desligar) e escrevê-lo já,
+// com as alterações que estavam pendentes
 void set_led_state(int led_index, uint8_t state) {
-    switch (led_index) {
-        case 0:
-            gpio_pin_set_dt(&led0, state);
-            break;
-        case 1:
-            gpio_pin_set_dt(&led1, state);
-            break;
-        case 2:
-            gpio_pin_set_dt(&led2, state);
-            break;
-        case 3:
-            gpio_pin_set_dt(&led3, state);
-            break;
-        default:
-            LOG_ERR("Invalid LED index: %d\n", led_index);
+    leds_stage(led_index, state);
+    leds_commit();
+}
+
+// Definir o estado de um LED, escrito no próximo leds_commit
+void leds_stage(int led_index, uint8_t state) {
+    if (led_index < 0 || led_index >= LEDS_COUNT) {
+        LOG_ERR("Invalid LED index: %d\n", led_index);
+        return;
     }
+
+    if (state)
+        led_state |= BIT(led_index);
+    else
+        led_state &= ~BIT(led_index);
+}
+
+// Definir o estado de todos os LEDs, um bit por LED, escrito no próximo leds_commit
+void leds_stage_mask(uint32_t mask) {
+    led_state = mask & BIT_MASK(LEDS_COUNT);
+}
+
+// Escrever os LEDs que mudaram: uma escrita mascarada por porto com alterações
+int leds_commit(void) {
+    uint32_t dirty = led_state ^ led_written;
+    int writes = 0;
+
+    if (!leds_ready || dirty == 0)
+        return 0;
+
+    for (int p = 0; p < n_ports; p++) {
+        gpio_port_pins_t mask = 0;
+        gpio_port_value_t value = 0;
+
+        for (int i = 0; i < LEDS_COUNT; i++) {
+            if (led_port[i] == p && (dirty & BIT(i))) {
+                mask |= BIT(leds[i].pin);
+                if (led_state & BIT(i))
+                    value |= BIT(leds[i].pin);
+            }
+        }
+        if (mask == 0)
+            continue;
+
+        // Valores lógicos: o driver aplica os flags GPIO_ACTIVE_LOW de cada pino
+        int err = gpio_port_set_masked(led_ports[p], mask, value);
+        if (err != 0) {
+            LOG_ERR("Failed to write LED port (%d)\n", err);
+            return err;
+        }
+        writes++;
+    }
+
+    led_written = led_state;
+    return writes;
 }
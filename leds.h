@@ -3,8 +3,24 @@
 
 #include <zephyr/drivers/gpio.h>
 
-void leds_init(void);
+// Número máximo de aliases led<i> procurados no devicetree
+#ifndef LEDS_MAX_CHANNELS
+#define LEDS_MAX_CHANNELS 8
+#endif
+
+// Os canais são os aliases led0, led1, ... do devicetree, pela ordem.
+// set_led_state escreve logo o LED. Para atualizar vários LEDs de uma vez,
+// leds_stage e leds_stage_mask só guardam o estado pretendido e leds_commit escreve
+// os pinos que mudaram desde a última escrita, com uma escrita por porto.
+int leds_init(void);
+int leds_count(void);
 void set_led_state(int led_index, uint8_t state);
+void leds_stage(int led_index, uint8_t state);
+void leds_stage_mask(uint32_t mask);
+
+// Retorna o número de portos escritos (0 se nada mudou), ou um erro negativo
+int leds_commit(void);
+
 void update_outputs(void);
 
 #endif // LEDS_H
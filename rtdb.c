@@ -0,0 +1,105 @@
+#include "rtdb.h"
+#include <stdlib.h>
+
+LOG_MODULE_REGISTER(RTDB_C);
+
+#define RTDB_ALIGN(size) (((size) + 3u) & ~3u)
+
+// Initializes the database with all fields zeroed
+int RTDB_Init(RTDB* db, const RTDB_FieldDef* defs, uint8_t n_fields) {
+    size_t total = 0;
+
+    for (int i = 0; i < n_fields; i++) {
+        total += RTDB_ALIGN(defs[i].size);
+    }
+
+    db->defs = defs;
+    db->n_fields = n_fields;
+    db->fields = (RTDB_Field*)malloc(sizeof(RTDB_Field) * n_fields);
+    db->storage = (uint8_t*)malloc(MAX(total, 1));
+    if (db->fields == NULL || db->storage == NULL) {
+        LOG_ERR("ERROR: Failed to allocate memory for RTDB\n");
+        free(db->fields);
+        free(db->storage);
+        return -1;
+    }
+    memset(db->storage, 0, MAX(total, 1));
+
+    size_t offset = 0;
+    for (int i = 0; i < n_fields; i++) {
+        RTDB_Field* f = &db->fields[i];
+        atomic_set(&f->seq, 0);
+        f->meta.version = 0;
+        f->meta.timestamp = 0;
+        f->size = defs[i].size;
+        f->data = &db->storage[offset];
+        memset(&f->write_lock, 0, sizeof(f->write_lock));
+        offset += RTDB_ALIGN(defs[i].size);
+    }
+    return 0;
+}
+
+int RTDB_Write(RTDB* db, uint8_t field, const void* value) {
+    if (field >= db->n_fields)
+        return -1;
+    return RTDB_WriteAt(db, field, 0, value, db->fields[field].size);
+}
+
+int RTDB_WriteAt(RTDB* db, uint8_t field, uint16_t offset, const void* value, uint16_t size) {
+    if (field >= db->n_fields || (uint32_t)offset + size > db->fields[field].size) {
+        LOG_ERR("ERROR: RTDB write out of field %u\n", field);
+        return -1;
+    }
+
+    RTDB_Field* f = &db->fields[field];
+    k_spinlock_key_t key = k_spin_lock(&f->write_lock);
+    atomic_val_t seq = atomic_get(&f->seq);
+
+    atomic_set(&f->seq, seq + 1);   // Readers retry from here on
+    barrier_dmem_fence_full();
+    memcpy(&f->data[offset], value, size);
+    f->meta.version++;
+    f->meta.timestamp = k_uptime_ticks();
+    barrier_dmem_fence_full();
+    atomic_set(&f->seq, seq + 2);
+
+    k_spin_unlock(&f->write_lock, key);
+    return 0;
+}
+
+int RTDB_Read(RTDB* db, uint8_t field, void* value, RTDB_Meta* meta) {
+    if (field >= db->n_fields)
+        return -1;
+
+    RTDB_Field* f = &db->fields[field];
+    while (true) {
+        atomic_val_t seq = atomic_get(&f->seq);
+        if (seq & 1)
+            continue;  // Write in progress on another CPU or from an interrupted context
+
+        barrier_dmem_fence_full();
+        memcpy(value, f->data, f->size);
+        RTDB_Meta copy = f->meta;
+        barrier_dmem_fence_full();
+
+        if (atomic_get(&f->seq) == seq) {
+            if (meta != NULL)
+                *meta = copy;
+            return 0;
+        }
+    }
+}
+
+uint32_t RTDB_Version(RTDB* db, uint8_t field) {
+    if (field >= db->n_fields)
+        return 0;
+
+    RTDB_Field* f = &db->fields[field];
+    while (true) {
+        atomic_val_t seq = atomic_get(&f->seq);
+        uint32_t version = f->meta.version;
+        barrier_dmem_fence_full();
+        if (!(seq & 1) && atomic_get(&f->seq) == seq)
+            return version;
+    }
+}
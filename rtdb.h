@@ -0,0 +1,65 @@
+#ifndef DEF_RTDB
+#define DEF_RTDB
+
+#include "stbs_port.h"
+#include <string.h>
+
+// Real-time database shared by the tasks.
+// Every field has its own seqlock: a writer bumps the field's sequence to odd, copies the
+// value in and bumps it back to even, holding a spinlock only for that copy. A reader
+// copies the value out and retries if the sequence was odd or changed meanwhile, so
+// readers never block and never delay a writer. Keep I/O and logging out of the write:
+// prepare the value first, then call RTDB_Write.
+//
+// Fields are declared in a table, indexed by an enum of the application:
+//
+//   enum { IO_INPUTS, IO_OUTPUTS };
+//   static const RTDB_FieldDef io_fields[] = {
+//       [IO_INPUTS] = {"inputs", 4},
+//       [IO_OUTPUTS] = {"outputs", 4},
+//   };
+//   RTDB_Init(&rtdb, io_fields, ARRAY_SIZE(io_fields));
+
+typedef struct {
+    const char* name;
+    uint16_t size;          // bytes
+} RTDB_FieldDef;
+
+// What a reader learns besides the value
+typedef struct {
+    uint32_t version;       // number of writes so far, 0 if never written
+    int64_t timestamp;      // kernel ticks of the last write
+} RTDB_Meta;
+
+typedef struct {
+    atomic_t seq;           // odd while a write is in progress
+    RTDB_Meta meta;
+    uint16_t size;
+    uint8_t* data;
+    struct k_spinlock write_lock;   // serialises writers of this field only
+} RTDB_Field;
+
+typedef struct {
+    const RTDB_FieldDef* defs;
+    uint8_t n_fields;
+    RTDB_Field* fields;
+    uint8_t* storage;       // values of all fields, word aligned
+} RTDB;
+
+// Initializes the database with all fields zeroed
+int RTDB_Init(RTDB* db, const RTDB_FieldDef* defs, uint8_t n_fields);
+
+// Writes a whole field; returns -1 for an unknown field
+int RTDB_Write(RTDB* db, uint8_t field, const void* value);
+
+// Writes size bytes of a field starting at offset; returns -1 if out of the field
+int RTDB_WriteAt(RTDB* db, uint8_t field, uint16_t offset, const void* value, uint16_t size);
+
+// Copies a consistent value of a field, and its version and timestamp when meta is not NULL.
+// Never blocks; returns -1 for an unknown field.
+int RTDB_Read(RTDB* db, uint8_t field, void* value, RTDB_Meta* meta);
+
+// Version of a field, to check for a change without reading it
+uint32_t RTDB_Version(RTDB* db, uint8_t field);
+
+#endif
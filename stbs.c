@@ -1,7 +1,7 @@
 #include "stbs.h"
+#include <stddef.h>
 #include <string.h>
-//#include <zephyr/logging/log.h>
-#include <zephyr/kernel.h>
+#include <stdlib.h>
 
 LOG_MODULE_REGISTER(STBS_C);
 
@@ -12,34 +12,277 @@ k_tid_t stbs_thread_id;
 // Forward declaration for the thread entry function
 void stbs_thread_entry(void *scheduler_ptr, void *unused1, void *unused2);
 
-// Initializes the STBS system
-int STBS_Init(STBS *scheduler, uint32_t tick_ms, uint8_t max_tasks) {
+static int STBS_BuildConfig(STBS* scheduler, STBS_Config* cfg);
+static int STBS_BuildTable(STBS* scheduler, STBS_Config* cfg);
+static int STBS_PublishConfig(STBS* scheduler);
+static int64_t STBS_ReleaseTime(STBS *scheduler, uint64_t tick);
+static void STBS_ApplyConfig(STBS* scheduler, STBS_Config* cfg);
+static void STBS_SetTaskTicks(STBS* scheduler);
+static int STBS_RunAnalysis(STBS *scheduler, Task *candidate, STBS_Analysis *result, bool store_bounds);
+static int STBS_AssignOffsets(STBS *scheduler, Task *only);
+static int STBS_PlaceOffsets(STBS *scheduler, Task *only);
+static void STBS_Release(STBS *scheduler, Task *t, int64_t release_time, uint32_t cycles);
+static void STBS_ReleaseConsumers(STBS *scheduler, Task *producer, uint32_t cycles);
+
+#if STBS_TRACE
+BUILD_ASSERT((STBS_TRACE_SIZE & (STBS_TRACE_SIZE - 1)) == 0, "STBS_TRACE_SIZE must be a power of 2");
+
+static STBS_TraceRecord trace_buf[STBS_TRACE_SIZE];
+static atomic_t trace_next;     // records written since the last clear
+static atomic_t trace_paused;
+
+// Appends a record stamped with cycles, a k_cycle_get_32() the caller already took, so the
+// releases of one event share the dispatcher's timestamp; callable from the dispatcher
+// and from task threads at once
+static inline void STBS_Trace(uint8_t type, uint8_t task, uint16_t arg, uint32_t cycles) {
+    if (atomic_get(&trace_paused))
+        return;
+
+    uint32_t i = (uint32_t)atomic_inc(&trace_next);
+    STBS_TraceRecord *r = &trace_buf[i & (STBS_TRACE_SIZE - 1)];
+    r->cycles = cycles;
+    r->type = type;
+    r->task = task;
+    r->arg = arg;
+}
+#else
+#define STBS_Trace(type, task, arg, cycles) do { } while (0)
+#endif
+
+#define STBS_SLOT(scheduler, t) ((uint8_t)((t) - (scheduler)->task_list))
+
+// Puts every field of a scheduler in its initial state, except the task slots
+static void STBS_Reset(STBS *scheduler, uint32_t tick_ms, uint8_t max_tasks) {
     scheduler->tick_ms = tick_ms;
     scheduler->ticks = 0;
     scheduler->max_tasks = max_tasks;
-    scheduler->task_list = (Task *)malloc(sizeof(Task) * max_tasks);
     scheduler->cycle_ticks = 0;
+    scheduler->start_time = 0;
+    scheduler->missed_ticks = 0;
+    scheduler->tick_policy = STBS_TICK_SKIP;
+    scheduler->n_events = 0;
+    scheduler->event_ticks = NULL;
+    scheduler->event_index = NULL;
+    scheduler->event_tasks = NULL;
+    scheduler->event = 0;
+    scheduler->cycle_start = 0;
+    scheduler->ms_base = 0;
+    scheduler->tick_base = 0;
     scheduler->running = false;
-    
-    if (scheduler->task_list == NULL) {
+    memset(&scheduler->analysis, 0, sizeof(scheduler->analysis));
+    k_mutex_init(&scheduler->lock);
+    memset(&scheduler->swap_lock, 0, sizeof(scheduler->swap_lock));
+    memset(&scheduler->next, 0, sizeof(scheduler->next));
+    memset(&scheduler->retired, 0, sizeof(scheduler->retired));
+    scheduler->next_ready = false;
+    scheduler->config_gen = 0;
+    scheduler->next_gen = 0;
+    scheduler->active_gen = 0;
+    memset(&scheduler->task_lock, 0, sizeof(scheduler->task_lock));
+    scheduler->event_hook = NULL;
+    scheduler->auto_offsets = false;
+    scheduler->static_table = NULL;
+#if STBS_STATS
+    memset(&scheduler->overhead, 0, sizeof(scheduler->overhead));
+#endif
+#if STBS_CPU_LOAD
+    memset(&scheduler->load_base, 0, sizeof(scheduler->load_base));
+#endif
+}
+
+// Carves the scratch arrays out of buf, STBS_SCRATCH_SIZE(max_tasks) bytes, 8-byte aligned
+static void STBS_SetScratch(STBS *scheduler, void *buf) {
+    size_t n = (size_t)scheduler->max_tasks + 1;
+
+    scheduler->scratch = buf;
+    scheduler->scratch_next = (uint64_t *)buf;
+    scheduler->scratch_set = (Task **)(scheduler->scratch_next + n);
+    scheduler->scratch_period = (uint32_t *)(scheduler->scratch_set + n);
+    scheduler->scratch_order = (uint8_t *)(scheduler->scratch_period + n);
+}
+
+// Initializes the STBS system
+int STBS_Init(STBS *scheduler, uint32_t tick_ms, uint8_t max_tasks) {
+    STBS_Reset(scheduler, tick_ms, max_tasks);
+    scheduler->task_list = (Task *)malloc(sizeof(Task) * max_tasks);
+    void *scratch = malloc(STBS_SCRATCH_SIZE(max_tasks));
+
+    if (scheduler->task_list == NULL || scratch == NULL) {
         LOG_INF("ERROR: Failed to allocate memory for tasks\n");
+        free(scheduler->task_list);
+        free(scratch);
         return -1;  // Indicate failure
     }
+    STBS_SetScratch(scheduler, scratch);
 
     // Initialize all task slots to NULL
     for (int i = 0; i < max_tasks; i++) {
         scheduler->task_list[i].task_id = NULL;
+        scheduler->task_list[i].state = STBS_TASK_COMPLETED;
+        scheduler->task_list[i].waiting = false;
     }
 
     return 0;  // Success
 }
 
+// Initializes a scheduler defined with STBS_DEFINE: the tasks go straight into the static
+// slots and the dispatch table into the static buffers, so nothing is allocated.
+// The tick is the GCD of the periods, set when the table is built.
+int STBS_InitStatic(STBS *scheduler, const STBS_StaticTable *table) {
+    STBS_Reset(scheduler, 0, table->n_tasks);
+    scheduler->task_list = table->task_list;
+    scheduler->static_table = table;
+    STBS_SetScratch(scheduler, table->scratch);
+
+    for (int i = 0; i < table->n_tasks; i++) {
+        const STBS_TaskDef *def = table->tasks[i];
+        Task *t = &scheduler->task_list[i];
+
+        if (def->fn != NULL)
+            Create_CallbackTaskWCET(t, def->period_ms, def->priority, (char *)def->task_id,
+                                    def->fn, def->ctx, def->wcet_us, def->deadline_ms);
+        else
+            Create_TaskWCET(t, def->period_ms, def->priority, (char *)def->task_id, *def->tid,
+                            def->wcet_us, def->deadline_ms);
+        k_sem_init(&t->release, 0, 1);
+    }
+
+    if (STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true) != 0) {
+        LOG_ERR("ERROR: Static task set not schedulable (U = %u/1000, %s misses its deadline)\n",
+                scheduler->analysis.utilisation_permille,
+                scheduler->analysis.failed_task ? scheduler->analysis.failed_task : "no task");
+        return -2;
+    }
+    if (STBS_CalculateTicks(scheduler) == 0) {
+        LOG_ERR("ERROR: Could not build dispatch table\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Slot holds a task of the current task set
+static bool STBS_InSet(Task *t) {
+    return t->task_id != NULL && t->retire_gen == 0;
+}
+
+// Slot is not dispatched anymore: empty, or removed and out of the dispatched configuration
+static bool STBS_Gone(STBS *scheduler, Task *t) {
+    return t->task_id == NULL ||
+           (t->retire_gen != 0 && (int32_t)(scheduler->active_gen - t->retire_gen) >= 0);
+}
+
+// Slot can take a new task: not dispatched anymore and no thread blocked on its semaphore
+static bool STBS_SlotFree(STBS *scheduler, Task *t) {
+    return STBS_Gone(scheduler, t) && !t->waiting;
+}
+
+// Consumer released by its producer in the next configuration built
+static bool STBS_Linked(Task *t) {
+    return t->producer >= 0 && t->unchain_gen == 0;
+}
+
+// Consumer released by its producer in the dispatched configuration
+static bool STBS_Chained(STBS *scheduler, Task *t) {
+    return t->producer >= 0 && (int32_t)(scheduler->active_gen - t->chain_gen) >= 0 &&
+           (t->unchain_gen == 0 || (int32_t)(scheduler->active_gen - t->unchain_gen) < 0);
+}
+
+// Forgets the links whose removal the dispatcher has switched to. Called with the lock
+// held, before the slots or links are looked at.
+static void STBS_DropUnchained(STBS *scheduler) {
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (t->producer >= 0 && t->unchain_gen != 0 &&
+            (int32_t)(scheduler->active_gen - t->unchain_gen) >= 0) {
+            scheduler->task_list[t->producer].n_consumers--;
+            t->producer = -1;
+            t->unchain_gen = 0;
+        }
+    }
+}
+
+// Unlinks consumer from its producer from the next configuration on, or at once while
+// stopped; until then its producer keeps releasing it
+static void STBS_Unchain(STBS *scheduler, Task *consumer) {
+    if (consumer->producer < 0 || consumer->unchain_gen != 0)
+        return;
+    if (scheduler->running) {
+        consumer->unchain_gen = scheduler->config_gen + 1;  // the next table built
+    } else {
+        scheduler->task_list[consumer->producer].n_consumers--;
+        consumer->producer = -1;
+    }
+}
+
+// Links back what STBS_Unchain marked for a configuration that could not be published
+static void STBS_Rechain(STBS *scheduler) {
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        if (scheduler->task_list[i].unchain_gen == scheduler->config_gen + 1)
+            scheduler->task_list[i].unchain_gen = 0;
+    }
+}
+
+// Wakes the thread still waiting for releases of a slot that is gone, so it leaves the
+// slot (see STBS_WaitActivation) before the semaphore is initialised for another task
+static void STBS_Unpark(STBS *scheduler) {
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (t->waiting && STBS_Gone(scheduler, t))
+            k_sem_give(&t->release);
+    }
+    k_spin_unlock(&scheduler->task_lock, key);
+}
+
+// Empties the slots of removed tasks; only while the dispatcher is not running
+static void STBS_ClearRetired(STBS *scheduler) {
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        if (scheduler->task_list[i].retire_gen != 0)
+            scheduler->task_list[i].task_id = NULL;
+    }
+    STBS_Unpark(scheduler);
+}
+
+// Releases the table of cfg; the table of a static scheduler is only dropped
+static void STBS_FreeConfig(STBS *scheduler, STBS_Config *cfg) {
+    if (scheduler->static_table == NULL) {
+        free(cfg->event_ticks);
+        free(cfg->event_index);
+        free(cfg->event_tasks);
+    }
+    cfg->n_events = 0;
+    cfg->event_ticks = NULL;
+    cfg->event_index = NULL;
+    cfg->event_tasks = NULL;
+}
+
 // Starts the STBS scheduler
 int STBS_Start(STBS *scheduler) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
     if (!scheduler->running) {
         // Initialize cycle_ticks based on current tasks' periods
-        scheduler->cycle_ticks = 0;
-        STBS_CalculateTicks(scheduler);
+        STBS_ClearRetired(scheduler);
+        if (scheduler->static_table != NULL && scheduler->event_ticks != NULL) {
+            // Fixed task set, the table built at init is still valid
+            scheduler->event = 0;
+            scheduler->cycle_start = 0;
+            scheduler->ticks = 0;
+        } else {
+            scheduler->cycle_ticks = 0;
+            STBS_CalculateTicks(scheduler);
+        }
+        if (scheduler->cycle_ticks > 0 && scheduler->event_ticks == NULL) {
+            LOG_ERR("ERROR: Could not build dispatch table\n");
+            k_mutex_unlock(&scheduler->lock);
+            return -1;
+        }
+        scheduler->active_gen = scheduler->config_gen;
+        STBS_DropUnchained(scheduler);
+        scheduler->missed_ticks = 0;
+        STBS_ResetStats(scheduler);
+        scheduler->start_time = k_uptime_ticks();
+        scheduler->ms_base = 0;
+        scheduler->tick_base = 0;
         scheduler->running = true;
 
         // Create Zephyr thread to execute scheduler tasks
@@ -50,106 +293,1435 @@ int STBS_Start(STBS *scheduler) {
                                          0, 0, K_NO_WAIT);  // priority 0, no options, start immediately
         
         LOG_INF("Scheduler has started\n");
+        k_mutex_unlock(&scheduler->lock);
         return 0;
     }
+    k_mutex_unlock(&scheduler->lock);
     return -1;  // Scheduler was already running
 }
 
 // Stops the STBS scheduler
 int STBS_Stop(STBS *scheduler) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
     if (scheduler->running) {
         scheduler->running = false;
         k_thread_abort(stbs_thread_id);  // Abort the scheduler thread
+
+        // A configuration that was not switched to yet is dropped; Start rebuilds it
+        if (scheduler->next_ready) {
+            STBS_FreeConfig(scheduler, &scheduler->next);
+            scheduler->next_ready = false;
+        }
+        STBS_FreeConfig(scheduler, &scheduler->retired);
+        scheduler->active_gen = scheduler->config_gen;  // What was published takes effect
+        STBS_DropUnchained(scheduler);
+        STBS_ClearRetired(scheduler);
+
         LOG_INF("Scheduler has stopped\n");
+        k_mutex_unlock(&scheduler->lock);
         return 0;
     }
+    k_mutex_unlock(&scheduler->lock);
     return -1;  // Scheduler was not running
 }
 
 // Create a task
 int Create_Task(Task *t, uint32_t period_ms, uint8_t priority, char *task_id, k_tid_t tid) {
+    return Create_TaskWCET(t, period_ms, priority, task_id, tid, 0, 0);
+}
+
+// Create a task with timing requirements
+int Create_TaskWCET(Task *t, uint32_t period_ms, uint8_t priority, char *task_id, k_tid_t tid,
+                    uint32_t wcet_us, uint32_t deadline_ms) {
+    if (period_ms == 0) {
+        LOG_ERR("ERROR: Task %s has no period\n", task_id);
+        return -1;
+    }
+
     t->period_ms = period_ms;
     t->priority = priority;
     t->period_ticks = 0;
+    t->offset_ms = 0;
+    t->offset_ticks = 0;
+    t->wcet_us = wcet_us;
+    t->deadline_ms = (deadline_ms == 0) ? period_ms : deadline_ms;
+    t->response_bound_us = 0;
     t->activations = 0;
     t->task_id = task_id;
     t->tid = tid;
+    t->fn = NULL;
+    t->ctx = NULL;
+    t->producer = -1;
+    t->n_consumers = 0;
+    t->chain_gen = 0;
+    t->unchain_gen = 0;
+    t->retire_gen = 0;
+    t->release_time = 0;
+    t->managed = false;
+    t->state = STBS_TASK_COMPLETED;
+    t->waiting = false;
+    t->overrun_policy = STBS_OVERRUN_SKIP;
+    t->overrun_param = 0;
+    t->pending = 0;
+    t->demoted = false;
+    t->base_priority = priority;
+    t->overruns = 0;
+    t->skipped = 0;
+    t->deadline_misses = 0;
+#if STBS_STATS
+    memset(&t->jitter, 0, sizeof(t->jitter));
+    memset(&t->response, 0, sizeof(t->response));
+    t->chain_cycles = 0;
+    memset(&t->end_to_end, 0, sizeof(t->end_to_end));
+#endif
     return 0;  // Success
 }
 
+// Create a task run by the dispatcher
+int Create_CallbackTask(Task *t, uint32_t period_ms, uint8_t priority, char *task_id,
+                        STBS_TaskFn fn, void *ctx) {
+    return Create_CallbackTaskWCET(t, period_ms, priority, task_id, fn, ctx, 0, 0);
+}
+
+int Create_CallbackTaskWCET(Task *t, uint32_t period_ms, uint8_t priority, char *task_id,
+                            STBS_TaskFn fn, void *ctx, uint32_t wcet_us, uint32_t deadline_ms) {
+    if (fn == NULL) {
+        LOG_ERR("ERROR: Task %s has no callback\n", task_id);
+        return -1;
+    }
+    if (Create_TaskWCET(t, period_ms, priority, task_id, NULL, wcet_us, deadline_ms) != 0)
+        return -1;
+
+    t->fn = fn;
+    t->ctx = ctx;
+    return 0;
+}
+
+// Copies t into a free slot. The dispatcher and task threads scan the slots without the
+// lock (STBS_ReleaseConsumers, STBS_CurrentTask), so the slot reads as empty while it is
+// filled, and its task_id goes in last to publish it.
+static void STBS_FillSlot(Task *slot, const Task *t) {
+    const size_t id_end = offsetof(Task, task_id) + sizeof(t->task_id);
+
+    slot->task_id = NULL;
+    barrier_dmem_fence_full();
+    memcpy(slot, t, offsetof(Task, task_id));
+    memcpy((char *)slot + id_end, (const char *)t + id_end, sizeof(Task) - id_end);
+    slot->retire_gen = 0;
+    k_sem_init(&slot->release, 0, 1);
+    barrier_dmem_fence_full();
+    slot->task_id = t->task_id;
+}
+
 // Adds a task to the scheduler
 int STBS_AddTask(STBS *scheduler, Task *t) {
-    // Stop scheduler if running
-    if (scheduler->running)
-        STBS_Stop(scheduler);
+    if (scheduler->static_table != NULL) {
+        LOG_ERR("ERROR: Task set of a static scheduler is fixed\n");
+        return -1;
+    }
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    STBS_DropUnchained(scheduler);
 
     // Add task
     for (int i = 0; i < scheduler->max_tasks; i++) {
-        if (scheduler->task_list[i].task_id == NULL) {
-            scheduler->task_list[i] = *t;
+        if (STBS_SlotFree(scheduler, &scheduler->task_list[i])) {
+            STBS_Analysis analysis;
+            if (STBS_Analyse(scheduler, t, &analysis) != 0) {
+                LOG_ERR("ERROR: Task %s rejected, task set not schedulable "
+                        "(U = %u/1000, peak tick load %u us, %s misses its deadline)\n",
+                        t->task_id, analysis.utilisation_permille, analysis.peak_tick_load_us,
+                        analysis.failed_task ? analysis.failed_task : "no task");
+                k_mutex_unlock(&scheduler->lock);
+                return -2;  // Not schedulable
+            }
+
+            STBS_FillSlot(&scheduler->task_list[i], t);
+            if (scheduler->auto_offsets)
+                STBS_PlaceOffsets(scheduler, &scheduler->task_list[i]);  // Admitted as given otherwise
+            if (scheduler->running && STBS_PublishConfig(scheduler) != 0) {
+                scheduler->task_list[i].task_id = NULL;
+                k_mutex_unlock(&scheduler->lock);
+                return -1;
+            }
+            STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
             LOG_INF("Task %s added.\n", t->task_id);
+            k_mutex_unlock(&scheduler->lock);
             return 0;  // Successfully added
         }
     }
 
     LOG_INF("ERROR: No available slots for adding a new task.\n");
+    k_mutex_unlock(&scheduler->lock);
     return -1;  // Failure
 }
 
+// Task a can delay task b: callback tasks run inside the dispatcher, ahead of every
+// thread task; within each kind, lower priority values go first
+static bool STBS_Interferes(Task *a, Task *b) {
+    if ((a->fn != NULL) != (b->fn != NULL))
+        return a->fn != NULL;
+    return a->priority <= b->priority;
+}
+
+int STBS_Analyse(STBS *scheduler, Task *candidate, STBS_Analysis *result) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);  // for the scratch arrays
+    int ret = STBS_RunAnalysis(scheduler, candidate, result, false);
+    k_mutex_unlock(&scheduler->lock);
+    return ret;
+}
+
+// Schedulability analysis of the used slots plus candidate.
+// Four tests, all must pass:
+//  - utilisation: sum of wcet / period within STBS_UTILISATION_BOUND
+//  - dispatcher load: the callback WCETs released in any tick of the macrocycle fit before
+//    the next tick that releases something, so the dispatcher is never late. Thread
+//    tasks may run past the next release; the response-time test covers them.
+//  - response time: R = C + sum over higher or equal priority tasks of ceil(R / T) * C,
+//    iterated to a fixed point, must not exceed the deadline. This assumes the critical
+//    instant, all tasks released together; with release offsets it may never happen, so
+//    the bound is safe but can be pessimistic.
+//  - end-to-end: a consumer's deadline runs from the release of the head of its chain,
+//    so its bound is its response time plus those of its producers up the chain.
+// The response bound of the candidate is always written back; with store_bounds,
+// the bounds of the slots are updated too.
+static int STBS_RunAnalysis(STBS *scheduler, Task *candidate, STBS_Analysis *result, bool store_bounds) {
+    Task **set = scheduler->scratch_set;
+    int n = 0;
+    uint64_t cycle_ms = 0;
+    uint64_t utilisation_ppm = 0;
+    uint64_t entries = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        if (STBS_InSet(&scheduler->task_list[i]))
+            set[n++] = &scheduler->task_list[i];
+    }
+    if (candidate != NULL)
+        set[n++] = candidate;
+
+    for (int i = 0; i < n; i++) {
+        if (i == 0) {
+            cycle_ms = set[i]->period_ms;
+            result->tick_ms = set[i]->period_ms;
+        } else {
+            if (cycle_ms != 0)
+                cycle_ms = LCM(cycle_ms, set[i]->period_ms);  // 0 once it overflows
+            result->tick_ms = GCD(result->tick_ms, set[i]->period_ms);
+        }
+        utilisation_ppm += ((uint64_t)set[i]->wcet_us * 1000 + set[i]->period_ms - 1) / set[i]->period_ms;
+    }
+    for (int i = 0; i < n; i++) {
+        if (set[i]->offset_ms != 0)
+            result->tick_ms = GCD(result->tick_ms, set[i]->offset_ms);
+    }
+    result->utilisation_permille = (utilisation_ppm + 999) / 1000;
+    result->schedulable = true;
+
+    if (n == 0)
+        return 0;
+
+    if (result->utilisation_permille > STBS_UTILISATION_BOUND) {
+        result->schedulable = false;
+    }
+
+    // The macrocycle must fit 32-bit tick counts and its releases the dispatch table
+    if (cycle_ms == 0 || cycle_ms / result->tick_ms > UINT32_MAX) {
+        LOG_ERR("ERROR: Hyperperiod of the task set overflows\n");
+        result->schedulable = false;
+        return -2;
+    }
+    result->cycle_ticks = cycle_ms / result->tick_ms;
+    for (int i = 0; i < n; i++) {
+        entries += cycle_ms / set[i]->period_ms;
+    }
+    if (entries > STBS_MAX_TABLE_ENTRIES) {
+        LOG_ERR("ERROR: Macrocycle needs %u releases, dispatch table holds %u\n",
+                (uint32_t)MIN(entries, UINT32_MAX), STBS_MAX_TABLE_ENTRIES);
+        result->schedulable = false;
+        return -2;
+    }
+
+    // Load of every microcycle that releases something, walking the releases in tick order.
+    // The callbacks of a tick must be done by the next one, the first tick of the next
+    // macrocycle for the last.
+    uint64_t *next = scheduler->scratch_next;
+    uint64_t first_tick = UINT64_MAX;
+    uint64_t last_tick = 0;
+    uint32_t last_callback_us = 0;
+    for (int i = 0; i < n; i++) {
+        next[i] = set[i]->offset_ms / result->tick_ms;
+        first_tick = MIN(first_tick, next[i]);
+    }
+    while (true) {
+        uint64_t tick = UINT64_MAX;
+        uint32_t load_us = 0;
+        uint32_t callback_us = 0;
+        for (int i = 0; i < n; i++) {
+            tick = MIN(tick, next[i]);
+        }
+        if (tick >= result->cycle_ticks)
+            break;
+
+        for (int i = 0; i < n; i++) {
+            if (next[i] == tick) {
+                load_us += set[i]->wcet_us;
+                if (set[i]->fn != NULL)
+                    callback_us += set[i]->wcet_us;
+                next[i] += set[i]->period_ms / result->tick_ms;
+            }
+        }
+        if (tick != first_tick && last_callback_us > (tick - last_tick) * result->tick_ms * 1000)
+            result->schedulable = false;
+        result->peak_tick_load_us = MAX(result->peak_tick_load_us, load_us);
+        last_tick = tick;
+        last_callback_us = callback_us;
+    }
+    if (last_callback_us > (result->cycle_ticks + first_tick - last_tick) * result->tick_ms * 1000)
+        result->schedulable = false;
+
+    // Fixed-priority response-time analysis (lower value = higher priority)
+    uint64_t *response = scheduler->scratch_next;   // done with the release walk
+    for (int i = 0; i < n; i++) {
+        uint64_t deadline_us = (uint64_t)set[i]->deadline_ms * 1000;
+        uint64_t wcet_us = MAX(set[i]->wcet_us, 1);     // Unknown WCET: still waits for the interference
+        uint64_t response_us = wcet_us;
+        uint64_t previous_us = 0;
+
+        while (response_us != previous_us && response_us <= deadline_us) {
+            previous_us = response_us;
+            response_us = wcet_us;
+            for (int j = 0; j < n; j++) {
+                if (j == i || !STBS_Interferes(set[j], set[i]))
+                    continue;
+                uint64_t period_us = (uint64_t)set[j]->period_ms * 1000;
+                response_us += (previous_us + period_us - 1) / period_us * set[j]->wcet_us;
+            }
+        }
+        response[i] = response_us;
+    }
+
+    // A consumer is released when its producer completes, so its bound and deadline run
+    // from the release of the head of its chain: the response times along the chain add up
+    for (int i = 0; i < n; i++) {
+        uint64_t deadline_us = (uint64_t)set[i]->deadline_ms * 1000;
+        uint64_t response_us = response[i];
+        for (Task *t = set[i]; STBS_Linked(t);) {
+            int j = 0;
+            while (j < n && set[j] != &scheduler->task_list[t->producer])
+                j++;
+            if (j == n)
+                break;
+            response_us += response[j];
+            t = set[j];
+        }
+
+        uint32_t bound_us = MIN(response_us, UINT32_MAX);
+        if (set[i] == candidate || store_bounds)
+            set[i]->response_bound_us = bound_us;
+        result->max_response_us = MAX(result->max_response_us, bound_us);
+
+        if (response_us > deadline_us && result->failed_task == NULL) {
+            result->failed_task = set[i]->task_id;
+            result->schedulable = false;
+        }
+    }
+
+    return result->schedulable ? 0 : -2;
+}
+
 uint32_t STBS_CalculateTicks(STBS* scheduler) {
-    uint32_t cycle_period = 0;
+    STBS_Config cfg;
+
+    if (scheduler->auto_offsets && STBS_PlaceOffsets(scheduler, NULL) == 0)
+        STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
+    int err = STBS_BuildConfig(scheduler, &cfg);
+
+    if (scheduler->static_table == NULL) {
+        free(scheduler->event_ticks);
+        free(scheduler->event_index);
+        free(scheduler->event_tasks);
+    }
+    STBS_ApplyConfig(scheduler, &cfg);
+    STBS_SetTaskTicks(scheduler);
+    scheduler->ticks = 0;
+    scheduler->ms_base = 0;
+    scheduler->tick_base = 0;
+    scheduler->config_gen++;
+
+    return (err == 0) ? scheduler->cycle_ticks : 0;
+}
+
+// Computes microcycle, macrocycle and dispatch table of the current task set into cfg.
+// Leaves the dispatched configuration alone, so it can run next to the dispatcher.
+static int STBS_BuildConfig(STBS* scheduler, STBS_Config* cfg) {
+    uint64_t cycle_period = 0;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->tick_ms = scheduler->tick_ms;  // Kept when there are no tasks
 
     // Determine microcycle duration
     for (int i = 0; i < scheduler->max_tasks; i++) {
-        Task t = scheduler->task_list[i];
-        if (t.task_id != NULL) {
-            if (cycle_period == 0) {
-                cycle_period = t.period_ms;
-                scheduler->tick_ms = t.period_ms;
+        Task* t = &scheduler->task_list[i];
+        if (STBS_InSet(t)) {
+            if (cfg->cycle_ticks == 0) {
+                cycle_period = t->period_ms;
+                cfg->tick_ms = t->period_ms;
+                cfg->cycle_ticks = 1;
             } else {
-                cycle_period = LCM(cycle_period, t.period_ms);
-                scheduler->tick_ms = GCD(scheduler->tick_ms, t.period_ms);
+                cycle_period = LCM(cycle_period, t->period_ms);
+                cfg->tick_ms = GCD(cfg->tick_ms, t->period_ms);
+                if (cycle_period == 0 || cycle_period / cfg->tick_ms > UINT32_MAX) {
+                    LOG_ERR("ERROR: Hyperperiod of the task set overflows\n");
+                    return -1;
+                }
             }
         }
     }
-    scheduler->ticks = 0;
-    scheduler->cycle_ticks = cycle_period / scheduler->tick_ms;
+    // Releases with an offset fall on ticks too
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task* t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && t->offset_ms != 0) {
+            cfg->tick_ms = GCD(cfg->tick_ms, t->offset_ms);
+        }
+    }
+    if (cycle_period != 0) {
+        if (cycle_period / cfg->tick_ms > UINT32_MAX) {
+            LOG_ERR("ERROR: Hyperperiod of the task set overflows\n");
+            return -1;
+        }
+        cfg->cycle_ticks = cycle_period / cfg->tick_ms;
+    }
+
+    // The tasks' own tick values change only when the dispatcher switches to cfg
+    return STBS_BuildTable(scheduler, cfg);
+}
+
+// Builds the configuration of the current task set and hands it to the dispatcher,
+// which switches to it at its next macrocycle boundary. Called with the lock held.
+static int STBS_PublishConfig(STBS* scheduler) {
+    STBS_Config cfg;
+    STBS_Config stale[2] = {0};
+
+    if (STBS_BuildConfig(scheduler, &cfg) != 0)
+        return -1;
+
+    k_spinlock_key_t key = k_spin_lock(&scheduler->swap_lock);
+    stale[0] = scheduler->retired;
+    memset(&scheduler->retired, 0, sizeof(scheduler->retired));
+    if (scheduler->next_ready)
+        stale[1] = scheduler->next;  // Superseded before the dispatcher got to it
+    scheduler->next = cfg;
+    scheduler->next_gen = ++scheduler->config_gen;
+    scheduler->next_ready = true;
+    k_spin_unlock(&scheduler->swap_lock, key);
 
-    // Update activation ticks for each task
+    // Neither is referenced by the dispatcher anymore
+    STBS_FreeConfig(scheduler, &stale[0]);
+    STBS_FreeConfig(scheduler, &stale[1]);
+    return 0;
+}
+
+// Makes cfg the dispatched configuration, starting at its first event
+static void STBS_ApplyConfig(STBS* scheduler, STBS_Config* cfg) {
+    scheduler->tick_ms = cfg->tick_ms;
+    scheduler->cycle_ticks = cfg->cycle_ticks;
+    scheduler->n_events = cfg->n_events;
+    scheduler->event_ticks = cfg->event_ticks;
+    scheduler->event_index = cfg->event_index;
+    scheduler->event_tasks = cfg->event_tasks;
+    scheduler->event = 0;
+    scheduler->cycle_start = 0;
+}
+
+// Tick values of the tasks of the dispatched configuration; a task added for a later one
+// gets them when the dispatcher switches to it
+static void STBS_SetTaskTicks(STBS* scheduler) {
     for (int i = 0; i < scheduler->max_tasks; i++) {
         Task* t = &scheduler->task_list[i];
-        if (t->task_id != NULL) {
+        if (!STBS_Gone(scheduler, t)) {
             t->period_ticks = t->period_ms / scheduler->tick_ms;
+            t->offset_ticks = t->offset_ms / scheduler->tick_ms;
         }
     }
+}
+
+// Dispatcher side of a mode change: release phases are relative to the macrocycle start,
+// so starting the new configuration's tick 0 at the old macrocycle boundary keeps the
+// release times of the tasks that stay in the set. start_time keeps its value and ticks
+// goes on counting elapsed time, in the new configuration's ticks.
+static void STBS_SwapConfig(STBS* scheduler) {
+    k_spinlock_key_t key = k_spin_lock(&scheduler->swap_lock);
+    if (scheduler->next_ready) {
+        uint64_t boundary_ms = scheduler->ms_base + scheduler->cycle_start * scheduler->tick_ms;
+
+        scheduler->retired.tick_ms = scheduler->tick_ms;
+        scheduler->retired.cycle_ticks = scheduler->cycle_ticks;
+        scheduler->retired.n_events = scheduler->n_events;
+        scheduler->retired.event_ticks = scheduler->event_ticks;
+        scheduler->retired.event_index = scheduler->event_index;
+        scheduler->retired.event_tasks = scheduler->event_tasks;
+
+        STBS_ApplyConfig(scheduler, &scheduler->next);
+        memset(&scheduler->next, 0, sizeof(scheduler->next));
+        scheduler->next_ready = false;
+        scheduler->active_gen = scheduler->next_gen;
 
-    return scheduler->cycle_ticks;
+        // A boundary that is not a whole number of new ticks counts the ticks it completed
+        scheduler->ms_base = boundary_ms;
+        scheduler->tick_base = boundary_ms / scheduler->tick_ms;
+        k_spin_unlock(&scheduler->swap_lock, key);
+        STBS_SetTaskTicks(scheduler);
+        STBS_Unpark(scheduler);  // Threads of the tasks removed by this switch
+        return;
+    }
+    k_spin_unlock(&scheduler->swap_lock, key);
+}
+
+// Builds the cyclic executive table of cfg for the current task set.
+// A task is released at its offset and every period after it. Only ticks that release
+// at least one task get an event, so the dispatcher can sleep straight from one event to
+// the next. Event e is at tick event_ticks[e] of the
+// macrocycle and owns event_tasks[event_index[e]] up to (excluding)
+// event_tasks[event_index[e + 1]]. Within an event, tasks are stored highest priority
+// first (lowest priority value, as in Zephyr), ties kept in slot order.
+static int STBS_BuildTable(STBS* scheduler, STBS_Config* cfg) {
+    uint8_t *order = scheduler->scratch_order;
+    uint32_t *period_ticks = scheduler->scratch_period;
+    uint64_t *next = scheduler->scratch_next;
+    int n = 0;
+    uint32_t total = 0;
+
+    cfg->n_events = 0;
+    cfg->event_ticks = NULL;
+    cfg->event_index = NULL;
+    cfg->event_tasks = NULL;
+
+    // Sort used slots in dispatch order, callback tasks first, then by priority
+    // (insertion sort keeps equal priorities in slot order)
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task* t = &scheduler->task_list[i];
+        if (!STBS_InSet(t) || STBS_Linked(t))
+            continue;  // Consumers are released by their producers
+
+        int j = n++;
+        while (j > 0 && !STBS_Interferes(&scheduler->task_list[order[j - 1]], t)) {
+            order[j] = order[j - 1];
+            period_ticks[j] = period_ticks[j - 1];
+            j--;
+        }
+        order[j] = i;
+        period_ticks[j] = t->period_ms / cfg->tick_ms;
+
+        if (cfg->cycle_ticks / period_ticks[j] > STBS_MAX_TABLE_ENTRIES - total) {
+            LOG_ERR("ERROR: Macrocycle needs more than %u releases\n", STBS_MAX_TABLE_ENTRIES);
+            return -1;
+        }
+        total += cfg->cycle_ticks / period_ticks[j];
+    }
+
+    if (n == 0) {
+        return 0;  // No tasks, nothing to dispatch
+    }
+
+    // Every task is released at tick 0, so there are at most as many events as releases
+    if (scheduler->static_table != NULL) {
+        const STBS_StaticTable *table = scheduler->static_table;
+        if (total > table->capacity) {
+            LOG_ERR("ERROR: Macrocycle needs %u releases, static table holds %u\n",
+                    total, table->capacity);
+            return -1;
+        }
+        cfg->event_ticks = table->event_ticks;
+        cfg->event_index = table->event_index;
+        cfg->event_tasks = table->event_tasks;
+    } else {
+        cfg->event_ticks = (uint32_t *)malloc(total * sizeof(uint32_t));
+        cfg->event_index = (uint32_t *)malloc((total + 1) * sizeof(uint32_t));
+        cfg->event_tasks = (uint8_t *)malloc(total);
+    }
+    if (cfg->event_ticks == NULL || cfg->event_index == NULL || cfg->event_tasks == NULL) {
+        LOG_ERR("ERROR: Failed to allocate memory for dispatch table\n");
+        STBS_FreeConfig(scheduler, cfg);
+        return -1;
+    }
+
+    // Merge the releases of all tasks in tick order
+    uint32_t entry = 0;
+    for (int i = 0; i < n; i++) {
+        next[i] = scheduler->task_list[order[i]].offset_ms / cfg->tick_ms;
+    }
+    while (true) {
+        uint64_t tick = UINT64_MAX;
+        for (int i = 0; i < n; i++) {
+            tick = MIN(tick, next[i]);
+        }
+        if (tick >= cfg->cycle_ticks)
+            break;
+
+        cfg->event_ticks[cfg->n_events] = tick;
+        cfg->event_index[cfg->n_events] = entry;
+        cfg->n_events++;
+        for (int i = 0; i < n; i++) {
+            if (next[i] == tick) {
+                cfg->event_tasks[entry++] = order[i];
+                next[i] += period_ticks[i];
+            }
+        }
+    }
+    cfg->event_index[cfg->n_events] = entry;
+
+    return 0;
 }
 
 // Removes a task from the scheduler
 int STBS_RemoveTask(STBS *scheduler, char *task_id) {
-    // Stop scheduler if running
-    if (scheduler->running)
-        STBS_Stop(scheduler);
+    if (scheduler->static_table != NULL) {
+        LOG_ERR("ERROR: Task set of a static scheduler is fixed\n");
+        return -1;
+    }
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    STBS_DropUnchained(scheduler);
 
     for (int i = 0; i < scheduler->max_tasks; i++) {
-        if (scheduler->task_list[i].task_id != NULL &&
-            strcmp(scheduler->task_list[i].task_id, task_id) == 0) {
-            scheduler->task_list[i].task_id = NULL;  // Mark slot as unused
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0) {
+            // Its consumers become time-triggered, its producer forgets it
+            for (int j = 0; j < scheduler->max_tasks; j++) {
+                if (scheduler->task_list[j].producer == i)
+                    STBS_Unchain(scheduler, &scheduler->task_list[j]);
+            }
+            STBS_Unchain(scheduler, t);
+            if (scheduler->running) {
+                // Slot stays in use until the dispatcher leaves the current configuration
+                t->retire_gen = scheduler->config_gen + 1;
+                if (STBS_PublishConfig(scheduler) != 0) {
+                    t->retire_gen = 0;
+                    STBS_Rechain(scheduler);
+                    k_mutex_unlock(&scheduler->lock);
+                    return -1;
+                }
+            } else {
+                t->task_id = NULL;  // Mark slot as unused
+                STBS_Unpark(scheduler);
+            }
+            STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
             LOG_INF("Task %s removed.\n", task_id);
+            k_mutex_unlock(&scheduler->lock);
             return 0;  // Successfully removed
         }
     }
     LOG_ERR("ERROR: Task not found.\n");
+    k_mutex_unlock(&scheduler->lock);
     return -1;  // Failure
 }
 
-// Task waits for its next activation
+int STBS_SetOffset(STBS *scheduler, char *task_id, uint32_t offset_ms) {
+    if (scheduler->static_table != NULL) {
+        LOG_ERR("ERROR: Task set of a static scheduler is fixed\n");
+        return -1;
+    }
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0) {
+            uint32_t previous = t->offset_ms;
+            STBS_Analysis analysis;
+
+            if (offset_ms >= t->period_ms) {
+                LOG_ERR("ERROR: Offset of task %s must be below its period\n", task_id);
+                k_mutex_unlock(&scheduler->lock);
+                return -1;
+            }
+            t->offset_ms = offset_ms;
+            if (STBS_Analyse(scheduler, NULL, &analysis) != 0) {
+                t->offset_ms = previous;
+                k_mutex_unlock(&scheduler->lock);
+                return -2;  // Not schedulable
+            }
+            if (scheduler->running && STBS_PublishConfig(scheduler) != 0) {
+                t->offset_ms = previous;
+                k_mutex_unlock(&scheduler->lock);
+                return -1;
+            }
+            STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
+            k_mutex_unlock(&scheduler->lock);
+            return 0;
+        }
+    }
+
+    k_mutex_unlock(&scheduler->lock);
+    return -1;  // Task not found
+}
+
+// Finds a task of the current set by id
+static Task *STBS_FindTask(STBS *scheduler, const char *task_id) {
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0)
+            return t;
+    }
+    return NULL;
+}
+
+int STBS_AddDependency(STBS *scheduler, char *producer_id, char *consumer_id) {
+    if (scheduler->static_table != NULL) {
+        LOG_ERR("ERROR: Task set of a static scheduler is fixed\n");
+        return -1;
+    }
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    STBS_DropUnchained(scheduler);
+
+    Task *producer = STBS_FindTask(scheduler, producer_id);
+    Task *consumer = STBS_FindTask(scheduler, consumer_id);
+    if (producer == NULL || consumer == NULL || consumer->producer >= 0 ||
+        producer->period_ms != consumer->period_ms) {
+        LOG_ERR("ERROR: Task %s cannot follow task %s\n", consumer_id, producer_id);
+        k_mutex_unlock(&scheduler->lock);
+        return -1;
+    }
+    if (consumer->fn != NULL && producer->fn == NULL) {
+        // It would run in the producer's thread instead of the dispatcher
+        LOG_ERR("ERROR: Callback task %s cannot follow thread task %s\n", consumer_id, producer_id);
+        k_mutex_unlock(&scheduler->lock);
+        return -1;
+    }
+    for (Task *p = producer; ; p = &scheduler->task_list[p->producer]) {
+        if (p == consumer) {
+            LOG_ERR("ERROR: Task %s already precedes task %s\n", consumer_id, producer_id);
+            k_mutex_unlock(&scheduler->lock);
+            return -1;
+        }
+        if (p->producer < 0)
+            break;
+    }
+
+    consumer->producer = STBS_SLOT(scheduler, producer);
+    consumer->chain_gen = scheduler->config_gen + 1;   // the next table built
+    consumer->unchain_gen = 0;
+    producer->n_consumers++;
+
+    STBS_Analysis analysis;
+    if (STBS_RunAnalysis(scheduler, NULL, &analysis, false) != 0) {
+        LOG_ERR("ERROR: Task %s cannot follow task %s, %s misses its end-to-end deadline\n",
+                consumer_id, producer_id, analysis.failed_task ? analysis.failed_task : "a task");
+        consumer->producer = -1;
+        producer->n_consumers--;
+        k_mutex_unlock(&scheduler->lock);
+        return -2;
+    }
+    if (scheduler->running && STBS_PublishConfig(scheduler) != 0) {
+        consumer->producer = -1;
+        producer->n_consumers--;
+        k_mutex_unlock(&scheduler->lock);
+        return -1;
+    }
+    STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
+    k_mutex_unlock(&scheduler->lock);
+    return 0;
+}
+
+int STBS_RemoveDependency(STBS *scheduler, char *consumer_id) {
+    if (scheduler->static_table != NULL) {
+        LOG_ERR("ERROR: Task set of a static scheduler is fixed\n");
+        return -1;
+    }
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    STBS_DropUnchained(scheduler);
+
+    Task *consumer = STBS_FindTask(scheduler, consumer_id);
+    if (consumer == NULL || consumer->producer < 0 || consumer->unchain_gen != 0) {
+        k_mutex_unlock(&scheduler->lock);
+        return -1;
+    }
+    STBS_Unchain(scheduler, consumer);
+    if (scheduler->running && STBS_PublishConfig(scheduler) != 0) {
+        STBS_Rechain(scheduler);
+        k_mutex_unlock(&scheduler->lock);
+        return -1;
+    }
+    STBS_RunAnalysis(scheduler, NULL, &scheduler->analysis, true);
+    k_mutex_unlock(&scheduler->lock);
+    return 0;
+}
+
+void STBS_SetAutoOffsets(STBS *scheduler, bool enable) {
+    scheduler->auto_offsets = enable;
+}
+
+// Adds the weight of a task to every tick it is released on
+static void STBS_AddLoad(uint32_t *load, uint32_t cycle_ticks, uint32_t offset, uint32_t period,
+                         uint32_t weight) {
+    for (uint32_t tick = offset; tick < cycle_ticks; tick += period) {
+        load[tick] += weight;
+    }
+}
+
+// Release offset optimiser, see STBS_SetAutoOffsets. Places only the task `only` if not
+// NULL, otherwise every task of the set. Called with the lock held or while stopped.
+// Offsets are only written once the placement cannot fail.
+// returns 0 on success, -1 if the macrocycle is too long or memory runs out, offsets untouched
+static int STBS_AssignOffsets(STBS *scheduler, Task *only) {
+    Task **set = scheduler->scratch_set;
+    int n = 0;
+    int placed = 0;
+    uint64_t cycle_ms = 0;
+    uint64_t tick_ms = 0;
+
+    // Tasks to place count as released at 0, the others with the offsets they keep
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (!STBS_InSet(t))
+            continue;
+
+        bool keep = only != NULL && t != only;
+        cycle_ms = (n == 0) ? t->period_ms : LCM(cycle_ms, t->period_ms);
+        tick_ms = GCD(GCD(tick_ms, t->period_ms), keep ? t->offset_ms : 0);
+        set[n++] = t;
+    }
+    if (n == 0)
+        return 0;
+    if (cycle_ms == 0 || cycle_ms / tick_ms > STBS_MAX_OFFSET_TICKS) {
+        LOG_WRN("Macrocycle too long to optimise release offsets, keeping them\n");
+        return -1;
+    }
+
+    uint32_t cycle_ticks = cycle_ms / tick_ms;
+    uint32_t *load = calloc(cycle_ticks, sizeof(uint32_t));
+    if (load == NULL) {
+        LOG_ERR("ERROR: Failed to allocate memory for release offsets\n");
+        return -1;
+    }
+
+    // Tasks that keep their offsets go into the profile first; the others are placed
+    // by decreasing WCET, shorter periods first on ties
+    for (int i = 0; i < n; i++) {
+        Task *t = set[i];
+        if (only != NULL && t != only) {
+            STBS_AddLoad(load, cycle_ticks, t->offset_ms / tick_ms, t->period_ms / tick_ms,
+                         MAX(t->wcet_us, 1));
+            continue;
+        }
+
+        int j = placed++;
+        while (j > 0 && (set[j - 1]->wcet_us < t->wcet_us ||
+                         (set[j - 1]->wcet_us == t->wcet_us && set[j - 1]->period_ms > t->period_ms))) {
+            set[j] = set[j - 1];
+            j--;
+        }
+        set[j] = t;
+    }
+
+    // Each task at the phase whose ticks carry the lowest peak so far (earliest on ties)
+    for (int i = 0; i < placed; i++) {
+        Task *t = set[i];
+        uint32_t period = t->period_ms / tick_ms;
+        uint32_t best = 0;
+        uint32_t best_peak = UINT32_MAX;
+
+        for (uint32_t offset = 0; offset < period; offset++) {
+            uint32_t peak = 0;
+            for (uint32_t tick = offset; tick < cycle_ticks && peak < best_peak; tick += period) {
+                peak = MAX(peak, load[tick]);
+            }
+            if (peak < best_peak) {
+                best = offset;
+                best_peak = peak;
+            }
+        }
+        t->offset_ms = best * tick_ms;
+        STBS_AddLoad(load, cycle_ticks, best, period, MAX(t->wcet_us, 1));
+    }
+
+    free(load);
+    return 0;
+}
+
+// Runs the optimiser and keeps its offsets only if the task set still passes the analysis:
+// a new phase moves the releases, and with them the gaps the callbacks must fit in.
+// Otherwise every offset goes back to what it was. Called with the lock held or while stopped.
+// returns 0 if the new offsets were kept
+static int STBS_PlaceOffsets(STBS *scheduler, Task *only) {
+    uint32_t *previous = scheduler->scratch_period;   // not used by the optimiser or the analysis
+    STBS_Analysis analysis;
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        previous[i] = scheduler->task_list[i].offset_ms;
+    }
+    if (STBS_AssignOffsets(scheduler, only) != 0)
+        return -1;
+    if (STBS_RunAnalysis(scheduler, NULL, &analysis, false) != 0) {
+        LOG_WRN("Optimised release offsets fail the analysis (%s), keeping the previous ones\n",
+                analysis.failed_task ? analysis.failed_task : "dispatcher load");
+        for (int i = 0; i < scheduler->max_tasks; i++) {
+            scheduler->task_list[i].offset_ms = previous[i];
+        }
+        return -1;
+    }
+    return 0;
+}
+
+uint32_t STBS_GetLoadProfile(STBS *scheduler, uint32_t *load_us, uint32_t max_ticks) {
+    // As in STBS_printLoadProfile: the table is only walked once its pointers are copied
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    k_spinlock_key_t key = k_spin_lock(&scheduler->swap_lock);
+    uint32_t cycle_ticks = scheduler->cycle_ticks;
+    uint32_t n_events = scheduler->n_events;
+    const uint32_t *event_ticks = scheduler->event_ticks;
+    const uint32_t *event_index = scheduler->event_index;
+    const uint8_t *event_tasks = scheduler->event_tasks;
+    k_spin_unlock(&scheduler->swap_lock, key);
+
+    memset(load_us, 0, MIN(cycle_ticks, max_ticks) * sizeof(uint32_t));
+    for (uint32_t e = 0; e < n_events; e++) {
+        if (event_ticks[e] >= max_ticks)
+            break;
+        for (uint32_t i = event_index[e]; i < event_index[e + 1]; i++) {
+            load_us[event_ticks[e]] += scheduler->task_list[event_tasks[i]].wcet_us;
+        }
+    }
+    k_mutex_unlock(&scheduler->lock);
+    return cycle_ticks;
+}
+
+void STBS_SetTickPolicy(STBS *scheduler, STBS_TickPolicy policy) {
+    scheduler->tick_policy = policy;
+}
+
+// Absolute release time of a tick of the dispatched configuration, in kernel ticks.
+// Always computed from start_time in ms, so rounding and wake-up latency never
+// accumulate, not even across mode changes.
+static int64_t STBS_ReleaseTime(STBS *scheduler, uint64_t tick) {
+    return scheduler->start_time +
+           k_ms_to_ticks_ceil64(scheduler->ms_base + tick * scheduler->tick_ms);
+}
+
+// Tick of the next event; with an empty table, every tick is a macrocycle of its own
+static uint64_t STBS_EventTick(STBS *scheduler) {
+    if (scheduler->n_events == 0)
+        return scheduler->cycle_start;
+    return scheduler->cycle_start + scheduler->event_ticks[scheduler->event];
+}
+
+// Moves on to the next event, wrapping around at the end of the macrocycle
+static void STBS_NextEvent(STBS *scheduler) {
+    if (++scheduler->event >= scheduler->n_events) {
+        scheduler->event = 0;
+        scheduler->cycle_start += MAX(scheduler->cycle_ticks, 1);
+    }
+}
+
+// Dispatcher sleeps until the absolute release time of the next event
 void STBS_WaitPeriod(STBS *scheduler) {
-    if (scheduler->running) {
-        k_msleep(scheduler->tick_ms);
-        scheduler->ticks++;
+    if (!scheduler->running)
+        return;
+
+    // Tick whose window contains the current time
+    int64_t now = k_uptime_ticks();
+    uint64_t current = 0;
+    if (now > scheduler->start_time) {
+        uint64_t elapsed_ms = k_ticks_to_ms_floor64(now - scheduler->start_time);
+        if (elapsed_ms > scheduler->ms_base)
+            current = (elapsed_ms - scheduler->ms_base) / scheduler->tick_ms;
     }
+
+    uint64_t tick = STBS_EventTick(scheduler);
+    if (tick < current && scheduler->n_events > 0) {
+        // The release of this event is at least a whole tick in the past
+        if (scheduler->tick_policy == STBS_TICK_SKIP) {
+            uint32_t missed = 0;
+            while (tick < current) {
+                missed++;
+                STBS_NextEvent(scheduler);
+                tick = STBS_EventTick(scheduler);
+            }
+            LOG_WRN("Missed %u release ticks, skipping to tick %llu\n", missed, (unsigned long long)tick);
+            scheduler->missed_ticks += missed;
+        } else {
+            scheduler->missed_ticks++;
+            scheduler->ticks = scheduler->tick_base + tick;
+            return;  // Late already, dispatch right away
+        }
+    }
+
+    scheduler->ticks = scheduler->tick_base + tick;
+    k_sleep(K_TIMEOUT_ABS_TICKS(STBS_ReleaseTime(scheduler, tick)));
+}
+
+#if STBS_STATS
+// Adds one measurement to a statistic
+static void STBS_StatAdd(STBS_Stat *stat, uint32_t us) {
+    int bin = (us == 0) ? 0 : 32 - __builtin_clz(us);
+    if (bin >= STBS_HIST_BINS)
+        bin = STBS_HIST_BINS - 1;
+
+    if (stat->count == 0 || us < stat->min_us)
+        stat->min_us = us;
+    if (us > stat->max_us)
+        stat->max_us = us;
+    stat->sum_us += us;
+    stat->count++;
+    if (stat->hist[bin] == UINT16_MAX) {
+        for (int b = 0; b < STBS_HIST_BINS; b++)
+            stat->hist[b] >>= 1;
+    }
+    stat->hist[bin]++;
+}
+#endif
+
+// Finds the task run by the calling thread. A slot of the task set comes first; the slot
+// of a removed task only while its job is in progress or the thread waits on it.
+static Task *STBS_CurrentTask(STBS *scheduler) {
+    k_tid_t tid = k_current_get();
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && t->fn == NULL && t->tid == tid)
+            return t;
+    }
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if ((t->state == STBS_TASK_RUNNING || t->waiting) && t->fn == NULL && t->tid == tid)
+            return t;
+    }
+    return NULL;
+}
+
+// Marks the start of a job of t at cycles; called with task_lock held
+static void STBS_JobStart(STBS *scheduler, Task *t, uint32_t cycles) {
+    t->state = STBS_TASK_RUNNING;
+    STBS_Trace(STBS_TRACE_START, STBS_SLOT(scheduler, t), t->activations, cycles);
+#if STBS_STATS
+    int64_t late = k_uptime_ticks() - t->release_time;
+    STBS_StatAdd(&t->jitter, (late > 0) ? k_ticks_to_us_floor32(late) : 0);
+    t->start_cycles = cycles;
+#endif
+}
+
+// Ends the job of t at cycles; called with task_lock held
+// returns true if the job missed its deadline
+static bool STBS_JobEnd(STBS *scheduler, Task *t, uint32_t cycles) {
+    STBS_Trace(STBS_TRACE_FINISH, STBS_SLOT(scheduler, t), t->activations, cycles);
+#if STBS_STATS
+    uint32_t response_us = k_cyc_to_us_floor32(cycles - t->start_cycles);
+    STBS_StatAdd(&t->response, response_us);
+    if (STBS_Chained(scheduler, t))
+        STBS_StatAdd(&t->end_to_end, k_cyc_to_us_floor32(cycles - t->chain_cycles));
+#endif
+    if (k_uptime_ticks() - t->release_time > (int64_t)k_ms_to_ticks_ceil64(t->deadline_ms)) {
+        t->deadline_misses++;
+        STBS_Trace(STBS_TRACE_DEADLINE_MISS, STBS_SLOT(scheduler, t), t->activations, cycles);
+        return true;
+    }
+    return false;
+}
+
+// Runs the job of a released callback task in the dispatcher
+// returns the cycles it took
+static uint32_t STBS_RunCallback(STBS *scheduler, Task *t) {
+    uint32_t start = k_cycle_get_32();
+
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    STBS_JobStart(scheduler, t, start);
+    k_spin_unlock(&scheduler->task_lock, key);
+
+    t->fn(t->ctx);
+
+    uint32_t end = k_cycle_get_32();
+    key = k_spin_lock(&scheduler->task_lock);
+    bool deadline_miss = STBS_JobEnd(scheduler, t, end);
+    t->state = STBS_TASK_COMPLETED;
+    k_spin_unlock(&scheduler->task_lock, key);
+
+    if (deadline_miss && scheduler->event_hook != NULL)
+        scheduler->event_hook(scheduler, t, STBS_EVENT_DEADLINE_MISS);
+    if (t->n_consumers > 0)
+        STBS_ReleaseConsumers(scheduler, t, end);
+    return k_cycle_get_32() - start;
+}
+
+int STBS_ServerInit(STBS_Server *server, STBS_AperiodicJob *queue, uint32_t queue_size,
+                    uint32_t budget_us) {
+    if (queue_size == 0 || (queue_size & (queue_size - 1)) != 0) {
+        LOG_ERR("ERROR: Server queue size %u is not a power of 2\n", queue_size);
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->budget_us = budget_us;
+    server->queue = queue;
+    server->queue_size = queue_size;
+    return 0;
+}
+
+// Job of a server task: runs queued jobs while the budget lasts
+static void STBS_ServerRun(void *ctx) {
+    STBS_Server *server = ctx;
+    uint32_t used_us = 0;
+
+    while (true) {
+        k_spinlock_key_t key = k_spin_lock(&server->lock);
+        if (server->head == server->tail ||
+            used_us + server->queue[server->head & (server->queue_size - 1)].wcet_us > server->budget_us) {
+            k_spin_unlock(&server->lock, key);
+            break;
+        }
+        STBS_AperiodicJob job = server->queue[server->head++ & (server->queue_size - 1)];
+        k_spin_unlock(&server->lock, key);
+
+        uint32_t start = k_cycle_get_32();
+        job.fn(job.ctx);
+        uint32_t elapsed_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+        used_us += MAX(elapsed_us, job.wcet_us);
+        key = k_spin_lock(&server->lock);
+        server->completed++;
+        if (used_us > server->budget_us)
+            server->overruns++;
+#if STBS_STATS
+        int64_t response = k_uptime_ticks() - job.submit_time;
+        STBS_StatAdd(&server->response, (response > 0) ? k_ticks_to_us_floor32(response) : 0);
+#endif
+        k_spin_unlock(&server->lock, key);
+        if (used_us >= server->budget_us)
+            break;
+    }
+}
+
+int Create_ServerTask(Task *t, uint32_t period_ms, uint8_t priority, char *task_id,
+                      STBS_Server *server) {
+    return Create_CallbackTaskWCET(t, period_ms, priority, task_id, STBS_ServerRun, server,
+                                   server->budget_us, 0);
+}
+
+int STBS_Submit(STBS_Server *server, STBS_TaskFn fn, void *ctx, uint32_t wcet_us) {
+    int ret = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&server->lock);
+    if (wcet_us > server->budget_us) {
+        ret = -2;  // Would never fit the budget
+    } else if (server->tail - server->head == server->queue_size) {
+        ret = -1;
+    } else {
+        STBS_AperiodicJob *job = &server->queue[server->tail++ & (server->queue_size - 1)];
+        job->fn = fn;
+        job->ctx = ctx;
+        job->wcet_us = wcet_us;
+        job->submit_time = k_uptime_ticks();
+        server->submitted++;
+    }
+    if (ret != 0)
+        server->rejected++;
+    k_spin_unlock(&server->lock, key);
+    return ret;
+}
+
+void STBS_GetServerStats(STBS_Server *server, STBS_ServerStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    k_spinlock_key_t key = k_spin_lock(&server->lock);
+    stats->queued = server->tail - server->head;
+    stats->submitted = server->submitted;
+    stats->completed = server->completed;
+    stats->rejected = server->rejected;
+    stats->overruns = server->overruns;
+#if STBS_STATS
+    stats->response = server->response;
+#endif
+    k_spin_unlock(&server->lock, key);
+}
+
+// Releases a task in the dispatcher at cycles, the timestamp of the event or of the
+// producer's completion. A release that finds the previous job of a managed task
+// unfinished is an overrun, handled by the task's overrun policy.
+static void STBS_Release(STBS *scheduler, Task *t, int64_t release_time, uint32_t cycles) {
+    bool overrun = false;
+    bool demote = false;
+
+    t->activations++;
+    STBS_Trace(STBS_TRACE_RELEASE, STBS_SLOT(scheduler, t), t->activations, cycles);
+#if STBS_STATS
+    // Only consumers measure from it: set by their producer, or here for the head of a chain
+    if (t->n_consumers > 0 && !STBS_Chained(scheduler, t))
+        t->chain_cycles = cycles;
+#endif
+    if (t->fn != NULL) {
+        // Callback task, run by the dispatcher right after its release
+        t->release_time = release_time;
+        t->state = STBS_TASK_RELEASED;
+        return;
+    }
+    if (!t->managed) {
+        t->release_time = release_time;
+        k_wakeup(t->tid);  // Thread parked in k_sleep(K_FOREVER)
+        if (t->n_consumers > 0)
+            STBS_ReleaseConsumers(scheduler, t, cycles);  // Its completion is unknown
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    if (t->state == STBS_TASK_COMPLETED) {
+        t->state = STBS_TASK_RELEASED;
+        t->release_time = release_time;
+        k_sem_give(&t->release);
+    } else {
+        overrun = true;
+        t->overruns++;
+        STBS_Trace(STBS_TRACE_OVERRUN, STBS_SLOT(scheduler, t), t->activations, cycles);
+        switch (t->overrun_policy) {
+        case STBS_OVERRUN_QUEUE:
+            if (t->pending < t->overrun_param)
+                t->pending++;
+            else
+                t->skipped++;
+            break;
+        case STBS_OVERRUN_DEMOTE:
+            if (t->pending < 1)
+                t->pending++;
+            else
+                t->skipped++;
+            demote = !t->demoted;
+            t->demoted = true;
+            break;
+        default:
+            t->skipped++;
+            break;
+        }
+    }
+    k_spin_unlock(&scheduler->task_lock, key);
+
+    if (demote) {
+        t->base_priority = k_thread_priority_get(t->tid);
+        k_thread_priority_set(t->tid, t->overrun_param);
+    }
+    if (overrun && scheduler->event_hook != NULL)
+        scheduler->event_hook(scheduler, t, STBS_EVENT_OVERRUN);
+}
+
+// Releases the consumers of producer, whose job just completed at cycles
+static void STBS_ReleaseConsumers(STBS *scheduler, Task *producer, uint32_t cycles) {
+    int16_t slot = STBS_SLOT(scheduler, producer);
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        // Linked or unlinked only once the dispatcher switches to the table that says so;
+        // a removed consumer is released until then too
+        if (t->producer != slot || STBS_Gone(scheduler, t) || !STBS_Chained(scheduler, t))
+            continue;
+
+#if STBS_STATS
+        t->chain_cycles = producer->chain_cycles;
+#endif
+        STBS_Release(scheduler, t, producer->release_time, cycles);
+        if (t->fn != NULL)
+            STBS_RunCallback(scheduler, t);
+    }
+}
+
+// Task thread waits for its next activation
+void STBS_WaitActivation(STBS *scheduler) {
+    Task *t = STBS_CurrentTask(scheduler);
+    bool completed = false;
+    bool deadline_miss = false;
+    bool restore = false;
+
+    if (t == NULL) {
+        k_sleep(K_FOREVER);  // Not a scheduled thread, behave like before
+        return;
+    }
+
+    // Job completion
+    uint32_t now = k_cycle_get_32();
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    if (t->state == STBS_TASK_RUNNING) {
+        completed = true;
+        deadline_miss = STBS_JobEnd(scheduler, t, now);
+        restore = t->demoted;
+        t->demoted = false;
+    }
+    t->managed = true;
+
+    // Releases queued by overruns start right away, each at its nominal release time;
+    // a task that is not dispatched anymore leaves its slot instead of waiting
+    bool gone = STBS_Gone(scheduler, t);
+    bool queued = t->pending > 0 && !gone;
+    if (queued) {
+        t->pending--;
+        t->release_time += k_ms_to_ticks_ceil64(t->period_ms);
+        STBS_JobStart(scheduler, t, now);
+    } else {
+        if (completed)
+            t->state = STBS_TASK_COMPLETED;  // A release made before this call stays
+        t->pending = 0;
+    }
+    t->waiting = !queued && !gone;
+    k_spin_unlock(&scheduler->task_lock, key);
+
+    if (restore)
+        k_thread_priority_set(t->tid, t->base_priority);
+    if (deadline_miss && scheduler->event_hook != NULL)
+        scheduler->event_hook(scheduler, t, STBS_EVENT_DEADLINE_MISS);
+    if (completed && t->n_consumers > 0)
+        STBS_ReleaseConsumers(scheduler, t, now);
+    if (queued)
+        return;
+    if (gone) {
+        k_sleep(K_FOREVER);  // Not a scheduled thread anymore
+        return;
+    }
+
+    // Never fails on Zephyr; the host port does not block and returns at once when no
+    // release is pending, leaving the task waiting for the next call
+    if (k_sem_take(&t->release, K_FOREVER) != 0)
+        return;
+
+    // Job start, unless woken by STBS_Unpark
+    key = k_spin_lock(&scheduler->task_lock);
+    t->waiting = false;
+    bool released = t->state == STBS_TASK_RELEASED;
+    if (released)
+        STBS_JobStart(scheduler, t, k_cycle_get_32());
+    k_spin_unlock(&scheduler->task_lock, key);
+    if (!released)
+        k_sleep(K_FOREVER);
+}
+
+int STBS_SetOverrunPolicy(STBS *scheduler, char *task_id, STBS_OverrunPolicy policy, uint8_t param) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);  // The slot is not reused while it is looked up
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0) {
+            k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+            t->overrun_policy = policy;
+            t->overrun_param = param;
+            k_spin_unlock(&scheduler->task_lock, key);
+            k_mutex_unlock(&scheduler->lock);
+            return 0;
+        }
+    }
+    k_mutex_unlock(&scheduler->lock);
+    return -1;  // Task not found
+}
+
+void STBS_SetEventHook(STBS *scheduler, STBS_EventHook hook) {
+    scheduler->event_hook = hook;
+}
+
+int STBS_GetTaskStats(STBS *scheduler, char *task_id, STBS_TaskStats *stats) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0) {
+            memset(stats, 0, sizeof(*stats));
+            k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+            stats->activations = t->activations;
+            stats->overruns = t->overruns;
+            stats->skipped = t->skipped;
+            stats->deadline_misses = t->deadline_misses;
+#if STBS_STATS
+            stats->jitter = t->jitter;
+            stats->response = t->response;
+            stats->end_to_end = t->end_to_end;
+#endif
+            k_spin_unlock(&scheduler->task_lock, key);
+            k_mutex_unlock(&scheduler->lock);
+            return 0;
+        }
+    }
+    k_mutex_unlock(&scheduler->lock);
+    return -1;  // Task not found
+}
+
+void STBS_GetStats(STBS *scheduler, STBS_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->ticks = scheduler->ticks;
+    stats->missed_ticks = scheduler->missed_ticks;
+#if STBS_STATS
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    stats->overhead = scheduler->overhead;
+    k_spin_unlock(&scheduler->task_lock, key);
+#endif
+#if STBS_CPU_LOAD
+    // Non-idle share of the cycles since the base, whatever ran in them
+    k_thread_runtime_stats_t usage;
+    if (scheduler->running && k_thread_runtime_stats_all_get(&usage) == 0) {
+        uint64_t elapsed = usage.execution_cycles - scheduler->load_base.execution_cycles;
+        uint64_t busy = usage.total_cycles - scheduler->load_base.total_cycles;
+        if (elapsed > 0)
+            stats->load_permille = MIN(busy * 1000 / elapsed, 1000);
+    }
+#endif
+}
+
+void STBS_ResetStats(STBS *scheduler) {
+#if STBS_CPU_LOAD
+    k_thread_runtime_stats_all_get(&scheduler->load_base);
+#endif
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+#if STBS_STATS
+    memset(&scheduler->overhead, 0, sizeof(scheduler->overhead));
+#endif
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        t->overruns = 0;
+        t->skipped = 0;
+        t->deadline_misses = 0;
+#if STBS_STATS
+        memset(&t->jitter, 0, sizeof(t->jitter));
+        memset(&t->response, 0, sizeof(t->response));
+        memset(&t->end_to_end, 0, sizeof(t->end_to_end));
+#endif
+    }
+    k_spin_unlock(&scheduler->task_lock, key);
+}
+
+void STBS_TraceDump(STBS *scheduler, STBS_TraceWriter write, void *ctx) {
+#if STBS_TRACE
+    STBS_TraceHeader header = {{'S', 'T', 'B', 'T'}, 1, 0, 0, 0, 0};
+
+    atomic_set(&trace_paused, 1);
+    uint32_t next = (uint32_t)atomic_get(&trace_next);
+    uint32_t n = MIN(next, STBS_TRACE_SIZE);
+
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        if (scheduler->task_list[i].task_id != NULL)
+            header.n_tasks++;
+    }
+    header.cycles_per_sec = sys_clock_hw_cycles_per_sec();
+    header.n_records = n;
+    header.lost = next - n;
+    write(&header, sizeof(header), ctx);
+
+    // Names of every slot in use, so records of removed tasks still decode
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (t->task_id != NULL) {
+            uint8_t entry[2] = {i, MIN(strlen(t->task_id), UINT8_MAX)};
+            write(entry, sizeof(entry), ctx);
+            write(t->task_id, entry[1], ctx);
+        }
+    }
+
+    for (uint32_t i = next - n; i != next; i++) {
+        write(&trace_buf[i & (STBS_TRACE_SIZE - 1)], sizeof(STBS_TraceRecord), ctx);
+    }
+    atomic_set(&trace_paused, 0);
+#else
+    ARG_UNUSED(scheduler);
+    ARG_UNUSED(write);
+    ARG_UNUSED(ctx);
+#endif
+}
+
+void STBS_TraceClear(void) {
+#if STBS_TRACE
+    atomic_set(&trace_next, 0);
+#endif
+}
+
+uint32_t STBS_StatAvg(const STBS_Stat *stat) {
+    return (stat->count == 0) ? 0 : (uint32_t)(stat->sum_us / stat->count);
 }
 
 // Scheduler thread entry function
@@ -157,30 +1729,53 @@ void stbs_thread_entry(void *scheduler_ptr, void *unused1, void *unused2) {
     STBS *scheduler = (STBS *)scheduler_ptr;
 
     while (scheduler->running) {
+        STBS_Dispatch(scheduler);
+    }
+}
 
-        // wake up threads
-        for (int i = 0; i < scheduler->max_tasks; i++) {
-            Task *current_task = &scheduler->task_list[i];
-            if (current_task->task_id != NULL) {
-                // Check if the task should be activated in this cycle
-                if (scheduler->ticks % current_task->period_ticks == 0) {
-                    LOG_INF("Activating task: %s (Activation %d)\n",
-                            current_task->task_id, current_task->activations + 1);
-                    current_task->activations++;
-                    k_wakeup(current_task->tid);
-                }
-            }
-        }
+// One pass of the dispatcher: sleeps to the next event and releases its tasks
+void STBS_Dispatch(STBS *scheduler) {
+    // Pending mode change, switched to at a macrocycle boundary
+    if (scheduler->next_ready && scheduler->event == 0) {
+        STBS_SwapConfig(scheduler);
+    }
+
+    // Sleep straight to the next tick that releases something
+    STBS_WaitPeriod(scheduler);
 
-        // Wait until next tick period
-        STBS_WaitPeriod(scheduler);
+    // One timestamp for the whole event: its trace records and the releases share it
+    uint32_t tick_start = k_cycle_get_32();
+    uint32_t callback_cycles = 0;
+    int64_t release_time = STBS_ReleaseTime(scheduler, scheduler->ticks - scheduler->tick_base);
+    STBS_Trace(STBS_TRACE_TICK, STBS_TRACE_NO_TASK, scheduler->ticks, tick_start);
+
+    // wake up threads due at this event, straight from the dispatch table, and run the
+    // callback tasks in place (traced, not logged: a log call per activation would
+    // dominate the tick)
+    if (scheduler->n_events > 0) {
+        uint32_t e = scheduler->event;
+        for (uint32_t i = scheduler->event_index[e]; i < scheduler->event_index[e + 1]; i++) {
+            Task *current_task = &scheduler->task_list[scheduler->event_tasks[i]];
+            STBS_Release(scheduler, current_task, release_time, tick_start);
+            if (current_task->fn != NULL)
+                callback_cycles += STBS_RunCallback(scheduler, current_task);
+        }
     }
+    STBS_NextEvent(scheduler);
+
+#if STBS_STATS
+    // Callback jobs are accounted as task time, not as dispatcher overhead
+    uint32_t overhead_us = k_cyc_to_us_floor32(k_cycle_get_32() - tick_start - callback_cycles);
+    k_spinlock_key_t key = k_spin_lock(&scheduler->task_lock);
+    STBS_StatAdd(&scheduler->overhead, overhead_us);
+    k_spin_unlock(&scheduler->task_lock, key);
+#endif
 }
 
 
 // Utility functions
-uint32_t GCD(uint32_t a, uint32_t b) {
-    uint32_t aux;
+uint64_t GCD(uint64_t a, uint64_t b) {
+    uint64_t aux;
     while (b != 0) {
         aux = b;
         b = a % b;
@@ -189,18 +1784,28 @@ uint32_t GCD(uint32_t a, uint32_t b) {
     return a;
 }
 
-uint32_t LCM(uint32_t a, uint32_t b) {
-    return a * b / GCD(a, b);
+uint64_t LCM(uint64_t a, uint64_t b) {
+    if (a == 0 || b == 0)
+        return 0;
+
+    uint64_t a_part = a / GCD(a, b);
+    if (a_part > UINT64_MAX / b)
+        return 0;  // Overflow
+    return a_part * b;
 }
 
 void STBS_printTaskByID(STBS* scheduler, char* task_id) {
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+
     for (int i = 0; i < scheduler->max_tasks; i++) {
-        Task t = scheduler->task_list[i];
-        if (strcmp(t.task_id, task_id) == 0) {
-            STBS_printTask(&scheduler->task_list[i]);
+        Task *t = &scheduler->task_list[i];
+        if (STBS_InSet(t) && strcmp(t->task_id, task_id) == 0) {
+            STBS_printTask(t);
+            k_mutex_unlock(&scheduler->lock);
             return;
         }
     }
+    k_mutex_unlock(&scheduler->lock);
 
     LOG_ERR("ERROR: TASK %s IS NOT IN TASK LIST\n", task_id);
 }
@@ -209,26 +1814,91 @@ void STBS_print(STBS* scheduler) {
     // Print scheduler info
     LOG_INF("SCHEDULER INFO:\n");
     LOG_INF("MICROCYCLE DURATION: %d ms\n", scheduler->tick_ms);
-    LOG_INF("TOTAL TICKS: %d\n", scheduler->ticks);
+    LOG_INF("TOTAL TICKS: %llu\n", (unsigned long long)scheduler->ticks);
     LOG_INF("MAX TASKS: %d\n", scheduler->max_tasks);
-    LOG_INF("TICKS PER MACROCYCLE: %d\n", scheduler->cycle_ticks);
+    LOG_INF("TICKS PER MACROCYCLE: %u\n", scheduler->cycle_ticks);
+    LOG_INF("RELEASE TICKS PER MACROCYCLE: %u\n", scheduler->n_events);
+    LOG_INF("MISSED TICKS: %d\n", scheduler->missed_ticks);
+    LOG_INF("UTILISATION: %u/1000\n", scheduler->analysis.utilisation_permille);
+    LOG_INF("PEAK TICK LOAD: %u us\n", scheduler->analysis.peak_tick_load_us);
 
     // Print tasks
     LOG_INF("\nTASK LIST:\n");
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
     for (int i = 0; i < scheduler->max_tasks; i++) {
-        Task t = scheduler->task_list[i];
-        if (t.task_id == NULL)
-            return;
+        if (!STBS_InSet(&scheduler->task_list[i]))
+            continue;
 
         LOG_INF("\n");
         STBS_printTask(&scheduler->task_list[i]);
     }
+    k_mutex_unlock(&scheduler->lock);
 }
 
 void STBS_printTask(Task* t) {
     LOG_INF("TASK %s:\n", t->task_id);
     LOG_INF("PERIOD = %d ms\n", t->period_ms);
-    LOG_INF("PRIORITY = %d\n", t->priority);
-    LOG_INF("TICKS PER ACTIVATION = %d\n", t->period_ticks);
-    LOG_INF("NUMBER OF ACTIVATIONS = %d\n", t->activations);
+    LOG_INF("PRIORITY = %d (%s task)\n", t->priority, (t->fn != NULL) ? "callback" : "thread");
+    LOG_INF("WCET = %u us, DEADLINE = %u ms\n", t->wcet_us, t->deadline_ms);
+    LOG_INF("RESPONSE TIME BOUND = %u us\n", t->response_bound_us);
+    LOG_INF("TICKS PER ACTIVATION = %u\n", t->period_ticks);
+    LOG_INF("NUMBER OF ACTIVATIONS = %u\n", t->activations);
+}
+
+static void STBS_printStat(const char *name, const STBS_Stat *stat) {
+    LOG_INF("%s: n=%u min=%u avg=%u max=%u us\n", name, stat->count,
+            stat->min_us, STBS_StatAvg(stat), stat->max_us);
+}
+
+void STBS_printStats(STBS* scheduler) {
+    STBS_Stats stats;
+    STBS_TaskStats task_stats;
+
+    STBS_GetStats(scheduler, &stats);
+    LOG_INF("SCHEDULER STATS:\n");
+    LOG_INF("TICKS = %llu (MISSED %u)\n", (unsigned long long)stats.ticks, stats.missed_ticks);
+    LOG_INF("CPU LOAD = %u.%u %%\n", stats.load_permille / 10, stats.load_permille % 10);
+    STBS_printStat("DISPATCH OVERHEAD", &stats.overhead);
+
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    for (int i = 0; i < scheduler->max_tasks; i++) {
+        Task *t = &scheduler->task_list[i];
+        if (!STBS_InSet(t) || STBS_GetTaskStats(scheduler, t->task_id, &task_stats) != 0)
+            continue;
+
+        LOG_INF("TASK %s: %u ACTIVATIONS, %u OVERRUNS (%u SKIPPED), %u DEADLINE MISSES\n",
+                t->task_id, task_stats.activations, task_stats.overruns,
+                task_stats.skipped, task_stats.deadline_misses);
+        STBS_printStat("RELEASE JITTER", &task_stats.jitter);
+        STBS_printStat("RESPONSE TIME", &task_stats.response);
+        if (t->producer >= 0)
+            STBS_printStat("END-TO-END LATENCY", &task_stats.end_to_end);
+    }
+    k_mutex_unlock(&scheduler->lock);
+}
+
+void STBS_printLoadProfile(STBS* scheduler) {
+    // The lock keeps the configuration from being freed, the spinlock from being swapped
+    // while its pointers are copied
+    k_mutex_lock(&scheduler->lock, K_FOREVER);
+    k_spinlock_key_t key = k_spin_lock(&scheduler->swap_lock);
+    uint32_t tick_ms = scheduler->tick_ms;
+    uint32_t cycle_ticks = scheduler->cycle_ticks;
+    uint32_t n_events = scheduler->n_events;
+    const uint32_t *event_ticks = scheduler->event_ticks;
+    const uint32_t *event_index = scheduler->event_index;
+    const uint8_t *event_tasks = scheduler->event_tasks;
+    k_spin_unlock(&scheduler->swap_lock, key);
+
+    LOG_INF("LOAD PROFILE (%u TICKS OF %u ms, PEAK %u us):\n", cycle_ticks, tick_ms,
+            scheduler->analysis.peak_tick_load_us);
+    for (uint32_t e = 0; e < n_events; e++) {
+        uint32_t load_us = 0;
+        for (uint32_t i = event_index[e]; i < event_index[e + 1]; i++) {
+            load_us += scheduler->task_list[event_tasks[i]].wcet_us;
+        }
+        LOG_INF("TICK %u: %u us, %u RELEASES\n", event_ticks[e], load_us,
+                event_index[e + 1] - event_index[e]);
+    }
+    k_mutex_unlock(&scheduler->lock);
 }
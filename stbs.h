@@ -1,34 +1,409 @@
 #ifndef DEF_STBS
 #define DEF_STBS
 
-#include <zephyr/kernel.h>
-#include <zephyr/sys/printk.h>
-#include <zephyr/logging/log.h>
+#include "stbs_port.h"
 #include <string.h>
 
 #define STACKSIZE 1024
 
+// Runtime timing statistics; cheap enough to leave on, set to 0 to compile them out
+#ifndef STBS_STATS
+#define STBS_STATS 1
+#endif
+
+// CPU load comes from the kernel's CPU usage accounting (CONFIG_SCHED_THREAD_USAGE_ALL):
+// job response times include preemption, so they cannot be added up into a load
+#if STBS_STATS && defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+#define STBS_CPU_LOAD 1
+#else
+#define STBS_CPU_LOAD 0
+#endif
+
+// Histogram bins: bin 0 counts values under 1 us, bin b counts [2^(b-1), 2^b) us,
+// the last bin also counts everything above
+#ifndef STBS_HIST_BINS
+#define STBS_HIST_BINS 16
+#endif
+
+// Min/avg/max and log2 histogram of a time measurement, in microseconds. The bins are
+// 16-bit and all halved when one fills up, so they give the shape of the distribution;
+// count has the total. 56 bytes with 16 bins: every Task slot, used or not, holds three,
+// 168 of its bytes, so size max_tasks to the task set (or set STBS_STATS to 0).
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint16_t hist[STBS_HIST_BINS];
+} STBS_Stat;
+
+// Binary event trace of the dispatcher and of managed tasks, dumped with STBS_TraceDump.
+// STBS_TRACE_SIZE records (8 bytes each, power of 2), the oldest overwritten first.
+// The records of a dispatched event share one timestamp, so a release costs a few
+// stores; set to 0 to compile the recorder out.
+#ifndef STBS_TRACE
+#define STBS_TRACE 1
+#endif
+#ifndef STBS_TRACE_SIZE
+#define STBS_TRACE_SIZE 256
+#endif
+
+// Largest dispatch table (task releases per macrocycle) a task set may need
+#ifndef STBS_MAX_TABLE_ENTRIES
+#define STBS_MAX_TABLE_ENTRIES 4096
+#endif
+
+// Largest macrocycle, in ticks, the release offset optimiser works on (4 bytes per tick
+// of heap while it runs)
+#ifndef STBS_MAX_OFFSET_TICKS
+#define STBS_MAX_OFFSET_TICKS 1024
+#endif
+
+// Admission control: the CPU share a task set may use, in 1/1000
+#ifndef STBS_UTILISATION_BOUND
+#define STBS_UTILISATION_BOUND 1000
+#endif
+
+// Job state of a task that marks its jobs with STBS_WaitActivation
+typedef enum {
+    STBS_TASK_COMPLETED,    // waiting for its next release
+    STBS_TASK_RELEASED,     // released, not started yet
+    STBS_TASK_RUNNING       // job started, not completed yet
+} STBS_TaskState;
+
+// What happens to a release that arrives before the previous job completed
+typedef enum {
+    STBS_OVERRUN_SKIP,      // drop the release
+    STBS_OVERRUN_QUEUE,     // keep up to N releases pending, started back-to-back on completion
+    STBS_OVERRUN_DEMOTE     // lower the late job to a given priority and keep one release pending
+} STBS_OverrunPolicy;
+
+// Timing faults reported to the event hook
+typedef enum {
+    STBS_EVENT_OVERRUN,         // released while the previous job had not completed
+    STBS_EVENT_DEADLINE_MISS    // job completed after its deadline
+} STBS_Event;
+
+// Job of a callback task, run to completion by the dispatcher
+typedef void (*STBS_TaskFn)(void* ctx);
+
 typedef struct {
     uint32_t period_ms;
     uint8_t priority;
-    uint8_t period_ticks;   // number of microcycle ticks between activations
-    uint8_t activations;
+    uint32_t period_ticks;  // number of microcycle ticks between activations
+    uint32_t offset_ms;     // release phase: first release this long after each macrocycle start
+    uint32_t offset_ticks;
+    uint32_t wcet_us;       // worst-case execution time, 0 if unknown
+    uint32_t deadline_ms;   // relative deadline, equal to the period unless given
+    uint32_t response_bound_us; // worst-case response time from the last admission test
+    uint32_t activations;
     char* task_id;
-    k_tid_t tid;
+    k_tid_t tid;            // NULL for a callback task
+    STBS_TaskFn fn;         // callback task: called by the dispatcher on every release, NULL for a thread task
+    void* ctx;              // argument of fn
+    int16_t producer;       // slot of the task whose job completion releases this one, -1 if time-triggered
+    uint8_t n_consumers;    // tasks released by the completion of this one
+    uint32_t chain_gen;     // first configuration in which the producer releases it
+    uint32_t unchain_gen;   // link removed: first configuration without it, 0 while linked
+    uint32_t retire_gen;    // removed: configuration that no longer dispatches it, 0 while in the task set
+    int64_t release_time;   // absolute release time of the current job, in kernel ticks
+    bool managed;           // thread waits with STBS_WaitActivation, so its job state is known
+    STBS_TaskState state;
+    struct k_sem release;   // given on every release of a managed task
+    bool waiting;           // thread blocked on release, the slot is not reused until it leaves
+    STBS_OverrunPolicy overrun_policy;
+    uint8_t overrun_param;  // QUEUE: max pending releases, DEMOTE: priority of a late job
+    uint8_t pending;        // releases waiting for the current job to complete
+    bool demoted;
+    int base_priority;      // thread priority to restore after a demotion
+    uint32_t overruns;      // releases that found the previous job unfinished
+    uint32_t skipped;       // releases dropped because of overruns
+    uint32_t deadline_misses;
+#if STBS_STATS
+    uint32_t start_cycles;  // cycle counter when the current job started
+    STBS_Stat jitter;       // release to job start
+    STBS_Stat response;     // job start to completion
+    uint32_t chain_cycles;  // cycle counter at the release of the head of the task's chain
+    STBS_Stat end_to_end;   // release of the head of the chain to completion, for consumers
+#endif
 } Task;
 
+// Result of the schedulability analysis of a task set
+typedef struct {
+    uint32_t utilisation_permille;  // sum of wcet / period, in 1/1000 (rounded up)
+    uint32_t tick_ms;               // microcycle of the analysed set
+    uint32_t cycle_ticks;           // macrocycle of the analysed set, in ticks
+    uint32_t peak_tick_load_us;     // largest sum of WCETs released in a single tick, may exceed a tick
+    uint32_t max_response_us;       // largest worst-case response time of the set
+    char* failed_task;              // first task whose response time exceeds its deadline, NULL if none
+    bool schedulable;
+} STBS_Analysis;
+
+// Snapshot of the statistics of one task
+typedef struct {
+    uint32_t activations;
+    uint32_t overruns;
+    uint32_t skipped;
+    uint32_t deadline_misses;
+    STBS_Stat jitter;
+    STBS_Stat response;
+    STBS_Stat end_to_end;
+} STBS_TaskStats;
+
+// Snapshot of the statistics of the scheduler itself
+typedef struct {
+    uint64_t ticks;
+    uint32_t missed_ticks;
+    STBS_Stat overhead;     // dispatcher time per tick
+    uint32_t load_permille; // CPU load (all threads) since STBS_Start or STBS_ResetStats, in 1/1000; 0 without STBS_CPU_LOAD
+} STBS_Stats;
+
+// What the dispatcher does when it wakes up after one or more tick releases have passed
+typedef enum {
+    STBS_TICK_SKIP,         // jump straight to the current tick; missed activations are dropped
+    STBS_TICK_CATCHUP       // dispatch every missed tick back-to-back until back on time
+} STBS_TickPolicy;
+
+// Timing configuration of a task set: built by STBS_AddTask/STBS_RemoveTask while the
+// scheduler runs, switched to by the dispatcher at a macrocycle boundary
+typedef struct {
+    uint32_t tick_ms;
+    uint32_t cycle_ticks;
+    uint32_t n_events;
+    uint32_t* event_ticks;
+    uint32_t* event_index;
+    uint8_t* event_tasks;
+} STBS_Config;
+
+// Kinds of trace records
+typedef enum {
+    STBS_TRACE_TICK,            // dispatcher woke up for an event; arg = tick (low 16 bits)
+    STBS_TRACE_RELEASE,         // task released; arg = activation (low 16 bits)
+    STBS_TRACE_START,           // job of a managed task started
+    STBS_TRACE_FINISH,          // job of a managed task completed
+    STBS_TRACE_OVERRUN,         // release found the previous job unfinished
+    STBS_TRACE_DEADLINE_MISS    // job completed after its deadline
+} STBS_TraceType;
+
+#define STBS_TRACE_NO_TASK 0xFF
+
+// One trace record; dumped as is (little endian)
+typedef struct {
+    uint32_t cycles;        // k_cycle_get_32() of the event (tick, releases) or of the job start/end
+    uint8_t type;           // STBS_TraceType
+    uint8_t task;           // slot in the task list, STBS_TRACE_NO_TASK for the dispatcher
+    uint16_t arg;
+} STBS_TraceRecord;
+
+// Start of a trace dump, followed by n_tasks entries (slot, name length, name bytes)
+// and by n_records STBS_TraceRecord, oldest first
+typedef struct {
+    char magic[4];          // "STBT"
+    uint16_t version;       // 1
+    uint16_t n_tasks;
+    uint32_t cycles_per_sec;
+    uint32_t n_records;
+    uint32_t lost;          // records overwritten before the dump
+} STBS_TraceHeader;
+
+// Receives the bytes of a trace dump, e.g. a wrapper of SEGGER_RTT_Write or of a UART
+typedef void (*STBS_TraceWriter)(const void* data, size_t len, void* ctx);
+
+// Aperiodic job waiting in a server queue
+typedef struct {
+    STBS_TaskFn fn;
+    void* ctx;
+    uint32_t wcet_us;       // charged against the server budget
+    int64_t submit_time;    // kernel ticks
+} STBS_AperiodicJob;
+
+// Polling server: a callback task that runs queued aperiodic jobs within a budget, see
+// STBS_ServerInit. Jobs come from STBS_Submit, in any context.
+typedef struct {
+    uint32_t budget_us;
+    STBS_AperiodicJob* queue;
+    uint32_t queue_size;    // power of 2
+    uint32_t head;          // next job to run
+    uint32_t tail;          // next free entry
+    struct k_spinlock lock;
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t rejected;      // queue full or job longer than the budget
+    uint32_t overruns;      // jobs that ran past the remaining budget
+#if STBS_STATS
+    STBS_Stat response;     // submission to completion
+#endif
+} STBS_Server;
+
+// Snapshot of the statistics of a server
+typedef struct {
+    uint32_t queued;
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t rejected;
+    uint32_t overruns;
+    STBS_Stat response;
+} STBS_ServerStats;
+
+// Task of a build-time schedule, see STBS_TASK_DEFINE
+typedef struct {
+    uint32_t period_ms;
+    uint8_t priority;
+    uint32_t wcet_us;
+    uint32_t deadline_ms;
+    const char* task_id;
+    const k_tid_t* tid;     // thread defined with K_THREAD_DEFINE, NULL for a callback task
+    STBS_TaskFn fn;
+    void* ctx;
+} STBS_TaskDef;
+
+// Scratch space of the analysis, the table builder and the offset optimiser for
+// max_tasks slots, in bytes: one entry per slot plus one for a candidate task
+#define STBS_SCRATCH_SIZE(max_tasks) \
+    ((size_t)((max_tasks) + 1) * (sizeof(uint64_t) + sizeof(Task*) + sizeof(uint32_t) + 1))
+
+// Static storage of a schedule defined with STBS_DEFINE
 typedef struct {
+    const STBS_TaskDef* const* tasks;
+    uint8_t n_tasks;
+    Task* task_list;        // n_tasks slots
+    uint32_t capacity;      // releases per macrocycle the table buffers hold
+    uint32_t* event_ticks;
+    uint32_t* event_index;  // capacity + 1 entries
+    uint8_t* event_tasks;
+    uint64_t* scratch;      // STBS_SCRATCH_SIZE(n_tasks) bytes
+} STBS_StaticTable;
+
+typedef struct STBS STBS;
+
+// Called from the dispatcher on an overrun and from the task thread on a deadline miss
+typedef void (*STBS_EventHook)(STBS* scheduler, Task* t, STBS_Event event);
+
+struct STBS {
     uint32_t tick_ms;       // duration of a microcycle tick in ms
-    uint32_t ticks;         // number of microcycle ticks since table generation
+    uint64_t ticks;         // time since the scheduler started, in ticks of the current tick_ms (rounded down)
     uint8_t max_tasks;
     Task* task_list;
-    uint8_t cycle_ticks;    // number of microcycle ticks in a macrocycle
+    uint32_t cycle_ticks;   // number of microcycle ticks in a macrocycle
+    int64_t start_time;     // absolute release time of tick 0, in kernel ticks
+    uint32_t missed_ticks;  // release ticks that had already passed when the dispatcher got to them
+    STBS_TickPolicy tick_policy;
+    // Dispatch table: only the ticks of the macrocycle that release something (events),
+    // event e is at tick event_ticks[e] (offsets included) and releases event_tasks[event_index[e]..event_index[e+1]],
+    // callback tasks first, then highest priority first
+    uint32_t n_events;
+    uint32_t* event_ticks;
+    uint32_t* event_index;
+    uint8_t* event_tasks;
+    uint32_t event;         // next event to dispatch
+    uint64_t cycle_start;   // tick at which the current macrocycle started
+    // Origin of the dispatched configuration's ticks, moved to the macrocycle boundary by a mode change
+    uint64_t ms_base;       // release time of its tick 0, in ms since start_time
+    uint64_t tick_base;     // value of ticks at its tick 0: ms_base / tick_ms
+    STBS_Analysis analysis; // analysis of the admitted task set
     bool running;
-} STBS;
+    struct k_mutex lock;    // serialises changes to the task set, and lookups by task_id
+    struct k_spinlock swap_lock;
+    STBS_Config next;       // configuration waiting for the next macrocycle boundary
+    bool next_ready;
+    STBS_Config retired;    // previous configuration, freed by the next change
+    uint32_t config_gen;    // generation of the latest built configuration
+    uint32_t next_gen;      // generation of next
+    uint32_t active_gen;    // generation of the configuration being dispatched
+    struct k_spinlock task_lock;    // job state and statistics of the tasks
+    STBS_EventHook event_hook;
+    bool auto_offsets;      // release offsets chosen by the optimiser, see STBS_SetAutoOffsets
+    // Scratch arrays carved from one buffer of STBS_SCRATCH_SIZE(max_tasks) bytes, so the
+    // analysis and table building stay off the caller's stack; used with lock held
+    void* scratch;
+    uint64_t* scratch_next;
+    Task** scratch_set;
+    uint32_t* scratch_period;
+    uint8_t* scratch_order;
+    const STBS_StaticTable* static_table;   // NULL unless defined with STBS_DEFINE
+#if STBS_STATS
+    STBS_Stat overhead;     // dispatcher time per tick
+#if STBS_CPU_LOAD
+    k_thread_runtime_stats_t load_base; // CPU usage at STBS_Start or STBS_ResetStats
+#endif
+#endif
+};
 
 // Initializes the STBS system
 int STBS_Init(STBS* scheduler, uint32_t tick_ms, uint8_t max_tasks);
 
+// Initializes a scheduler on the static storage of STBS_DEFINE and builds its table.
+// Runs before main from the SYS_INIT hook of STBS_DEFINE, not meant to be called directly.
+int STBS_InitStatic(STBS* scheduler, const STBS_StaticTable* table);
+
+// Build-time schedules, in the style of K_THREAD_DEFINE:
+//
+//   K_THREAD_DEFINE(blink_thread, STACKSIZE, blink, NULL, NULL, NULL, 5, 0, 0);
+//   STBS_TASK_DEFINE(blink, 100, 5, blink_thread);
+//   STBS_DEFINE(scheduler, 1000, blink, ...);
+//
+// defines `STBS scheduler` with its task slots and dispatch table in static storage, no heap.
+// The tick is the GCD of the periods, as for a scheduler built at run time. Every period
+// must divide cycle_ms, otherwise the build fails, as it does when the macrocycle has more
+// than STBS_MAX_TABLE_ENTRIES releases. See STBS_static. The table
+// is filled once before main; the application only calls STBS_Start. The task set is fixed:
+// STBS_AddTask and STBS_RemoveTask fail on such a scheduler.
+// STBS_CALLBACK_TASK_DEFINE(name, period_ms, priority, fn, ctx) defines a callback task
+// instead, see Create_CallbackTask.
+#define STBS_TASK_DEFINE(name, period_ms, priority, thread) \
+    STBS_TASK_DEFINE_WCET(name, period_ms, priority, thread, 0, 0)
+
+#define STBS_CALLBACK_TASK_DEFINE(name, period_ms, priority, fn, ctx) \
+    STBS_CALLBACK_TASK_DEFINE_WCET(name, period_ms, priority, fn, ctx, 0, 0)
+
+#define STBS_TASK_DEFINE_WCET(name, period_ms, priority, thread, wcet_us, deadline_ms)  \
+    enum { name##_stbs_period = (period_ms) };                                          \
+    BUILD_ASSERT((period_ms) > 0, "STBS task " #name " has no period");                 \
+    static const STBS_TaskDef name = {                                                  \
+        (period_ms), (priority), (wcet_us), (deadline_ms), #name, &thread, NULL, NULL   \
+    }
+
+#define STBS_CALLBACK_TASK_DEFINE_WCET(name, period_ms, priority, fn, ctx, wcet_us, deadline_ms) \
+    enum { name##_stbs_period = (period_ms) };                                          \
+    BUILD_ASSERT((period_ms) > 0, "STBS task " #name " has no period");                 \
+    static const STBS_TaskDef name = {                                                  \
+        (period_ms), (priority), (wcet_us), (deadline_ms), #name, NULL, (fn), (ctx)     \
+    }
+
+#define STBS_DEFINE(name, cycle_ms, ...)                                                \
+    FOR_EACH_FIXED_ARG(STBS__CHECK_CYCLE, (;), cycle_ms, __VA_ARGS__);                  \
+    enum {                                                                              \
+        name##_stbs_entries = 0 FOR_EACH_FIXED_ARG(STBS__RELEASES, (), cycle_ms, __VA_ARGS__) \
+    };                                                                                  \
+    BUILD_ASSERT(name##_stbs_entries <= STBS_MAX_TABLE_ENTRIES,                         \
+                 "Macrocycle of STBS " #name " has too many releases");                 \
+    static const STBS_TaskDef* const name##_stbs_tasks[] = {                            \
+        FOR_EACH(STBS__TASK_REF, (,), __VA_ARGS__)                                      \
+    };                                                                                  \
+    BUILD_ASSERT(ARRAY_SIZE(name##_stbs_tasks) <= UINT8_MAX, "Too many STBS tasks");    \
+    static Task name##_stbs_task_list[ARRAY_SIZE(name##_stbs_tasks)];                   \
+    static uint32_t name##_stbs_event_ticks[name##_stbs_entries];                       \
+    static uint32_t name##_stbs_event_index[name##_stbs_entries + 1];                   \
+    static uint8_t name##_stbs_event_tasks[name##_stbs_entries];                        \
+    static uint64_t name##_stbs_scratch[                                                \
+        DIV_ROUND_UP(STBS_SCRATCH_SIZE(ARRAY_SIZE(name##_stbs_tasks)), sizeof(uint64_t))]; \
+    static const STBS_StaticTable name##_stbs_table = {                                 \
+        name##_stbs_tasks, ARRAY_SIZE(name##_stbs_tasks), name##_stbs_task_list,        \
+        name##_stbs_entries, name##_stbs_event_ticks, name##_stbs_event_index,          \
+        name##_stbs_event_tasks, name##_stbs_scratch                                    \
+    };                                                                                  \
+    STBS name;                                                                          \
+    static int name##_stbs_init(void) {                                                 \
+        return STBS_InitStatic(&name, &name##_stbs_table);                              \
+    }                                                                                   \
+    SYS_INIT(name##_stbs_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY)
+
+#define STBS__CHECK_CYCLE(task, cycle_ms) \
+    BUILD_ASSERT((cycle_ms) % task##_stbs_period == 0, \
+                 "Period of STBS task " #task " does not divide the macrocycle")
+#define STBS__RELEASES(task, cycle_ms) + (cycle_ms) / task##_stbs_period
+#define STBS__TASK_REF(task) &task
+
 // Starts the STBS scheduler
 // returns 0 on success
 int STBS_Start(STBS* scheduler);
@@ -37,24 +412,163 @@ int STBS_Start(STBS* scheduler);
 int STBS_Stop(STBS* scheduler);
 
 // Create task struct. Task thread must be defined
+// The task has no WCET, so admission control only checks the rest of the set against it
 int Create_Task(Task* t, uint32_t period_ms, uint8_t priority, char* task_id, k_tid_t tid);
 
+// Create task struct with its worst-case execution time (us) and relative deadline (ms)
+// deadline_ms = 0 uses the period as deadline
+int Create_TaskWCET(Task* t, uint32_t period_ms, uint8_t priority, char* task_id, k_tid_t tid,
+                    uint32_t wcet_us, uint32_t deadline_ms);
+
+// Create a callback task: fn(ctx) is called by the dispatcher itself on every release,
+// on the dispatcher's stack (STACKSIZE), instead of waking up a thread. Callbacks due in
+// the same tick run in priority order, all of them ahead of the thread tasks released
+// with them, and must not block. Meant for short jobs such as I/O updates, where the
+// two context switches and the stack of a thread would cost more than the job itself.
+int Create_CallbackTask(Task* t, uint32_t period_ms, uint8_t priority, char* task_id,
+                        STBS_TaskFn fn, void* ctx);
+
+int Create_CallbackTaskWCET(Task* t, uint32_t period_ms, uint8_t priority, char* task_id,
+                            STBS_TaskFn fn, void* ctx, uint32_t wcet_us, uint32_t deadline_ms);
+
+// Aperiodic work, e.g. a UART command or a button event, goes to a polling server instead
+// of a periodic task that polls for it. The server is a callback task with the budget as
+// its WCET, so admission control and the dispatch table treat it like any other task
+// and the periodic releases are not disturbed. On each release it runs queued jobs in
+// FIFO order while the budget covers the next job's WCET (a job is charged its WCET or
+// the time it took, whichever is longer); budget left over is lost until the next period.
+// queue holds queue_size jobs (power of 2)
+// returns 0 on success, -1 if queue_size is not a power of 2
+int STBS_ServerInit(STBS_Server* server, STBS_AperiodicJob* queue, uint32_t queue_size,
+                    uint32_t budget_us);
+
+// Create the task of a server, added with STBS_AddTask
+int Create_ServerTask(Task* t, uint32_t period_ms, uint8_t priority, char* task_id,
+                      STBS_Server* server);
+
+// Queues fn(ctx) on a server; callable from ISRs. wcet_us = 0 charges the measured time only
+// returns 0 on success, -1 if the queue is full, -2 if wcet_us exceeds the budget
+int STBS_Submit(STBS_Server* server, STBS_TaskFn fn, void* ctx, uint32_t wcet_us);
+
+// Copies the statistics of a server
+void STBS_GetServerStats(STBS_Server* server, STBS_ServerStats* stats);
+
 // Adds a task to the scheduler
-// If necessary, stops the scheduler to adjust vars
+// Safe to call from any thread while the scheduler runs: the new configuration is built
+// here and taken over by the dispatcher at the next macrocycle boundary, so the tasks
+// already in the set keep their release times
+// returns 0 on success, -1 if there is no free slot, -2 if the resulting task set is not schedulable
+// The bounds of the task set are left in scheduler->analysis and t->response_bound_us
 int STBS_AddTask(STBS* scheduler, Task* t);
 
-// Recalculates temporal values; useful when tasks are added/removed
+// Schedulability analysis of the task set plus an optional candidate task (may be NULL):
+// utilisation bound, load of every microcycle and fixed-priority response-time analysis
+// (callback tasks count as higher priority than every thread task)
+// returns 0 if schedulable, -2 otherwise
+int STBS_Analyse(STBS* scheduler, Task* candidate, STBS_Analysis* result);
+
+// Sets the release offset of a task: it is released offset_ms (< period) after the start
+// of every macrocycle and every period after that, instead of together with every other
+// task at tick 0. The tick shrinks to a divisor of the offset if needed. While running,
+// takes effect at the next macrocycle boundary, like STBS_AddTask.
+// returns 0 on success, -1 if the task is not in the task list or offset_ms >= period,
+// -2 if the task set with the offset is not schedulable
+int STBS_SetOffset(STBS* scheduler, char* task_id, uint32_t offset_ms);
+
+// Lets the scheduler pick release offsets to flatten the load of the microcycles. Greedy:
+// tasks by decreasing WCET (tasks without one count as 1 us), each at the phase whose
+// ticks have the lowest peak load so far. STBS_CalculateTicks and STBS_Start of a stopped
+// scheduler place every task; STBS_AddTask places the new task around the others, which
+// keep their offsets. Needs a macrocycle of at most STBS_MAX_OFFSET_TICKS ticks. A placement
+// that fails the schedulability analysis is dropped: the offsets stay as they were, the
+// caller's for an added task.
+void STBS_SetAutoOffsets(STBS* scheduler, bool enable);
+
+// Load profile of the dispatched configuration: sum of the WCETs released in each tick
+// of the macrocycle, for the first max_ticks ticks
+// returns the number of ticks in the macrocycle
+uint32_t STBS_GetLoadProfile(STBS* scheduler, uint32_t* load_us, uint32_t max_ticks);
+
+// Recalculates temporal values and rebuilds the macrocycle dispatch table of a stopped
+// scheduler; restarts the tick count
+// returns the number of ticks per macrocycle, 0 if there are no tasks or the table could not be allocated
 uint32_t STBS_CalculateTicks(STBS* scheduler);
 
 // Removes a task from the scheduler
+// Like STBS_AddTask, takes effect at the next macrocycle boundary when running
 int STBS_RemoveTask(STBS* scheduler, char* task_id);
 
-// Task waits for its next activation
+// Selects how missed ticks are handled (default: STBS_TICK_SKIP)
+void STBS_SetTickPolicy(STBS* scheduler, STBS_TickPolicy policy);
+
+// Dispatcher sleeps until the absolute release time of the next tick that releases a task
 void STBS_WaitPeriod(STBS* scheduler);
 
+// One pass of the dispatcher: waits for the next event and releases its tasks.
+// The scheduler thread loops on it; the host simulator (host/) calls it directly.
+void STBS_Dispatch(STBS* scheduler);
+
+// Task thread waits for its next activation; use instead of k_sleep(K_FOREVER)
+// Marks the end of the current job and the start of the next one, which enables
+// overrun and deadline-miss detection and the timing statistics for the task
+void STBS_WaitActivation(STBS* scheduler);
+
+// Makes consumer a successor of producer: instead of its own releases, consumer is
+// released as soon as each job of producer completes, with the producer's release time,
+// so its deadline and its end-to-end latency statistic run from the release of the head
+// of the chain. Both need the same period. Producers must be callback tasks or mark
+// their jobs with STBS_WaitActivation; the consumers of any other thread are released
+// right after it. A callback consumer needs a callback producer, so that it still runs
+// in the dispatcher, right after it. A task has at most one producer; chains and fan-out
+// are fine. Admission takes the consumer's deadline as end-to-end: the response times
+// along the chain must fit in it. While running, takes effect at the next macrocycle
+// boundary, like STBS_AddTask.
+// returns 0 on success, -1 if a task is missing, the periods differ, consumer already
+// has a producer, is a callback task following a thread task, or the dependency would
+// close a cycle, -2 if the end-to-end deadline cannot be met
+int STBS_AddDependency(STBS* scheduler, char* producer_id, char* consumer_id);
+
+// Makes consumer time-triggered again
+// returns 0 on success, -1 if the task is missing or has no producer
+int STBS_RemoveDependency(STBS* scheduler, char* consumer_id);
+
+// Sets how releases that find the previous job unfinished are handled (default: STBS_OVERRUN_SKIP)
+// param: max pending releases for STBS_OVERRUN_QUEUE, priority of the late job for STBS_OVERRUN_DEMOTE
+// returns 0 on success, -1 if the task is not in the task list
+int STBS_SetOverrunPolicy(STBS* scheduler, char* task_id, STBS_OverrunPolicy policy, uint8_t param);
+
+// Installs a hook called on every overrun and deadline miss, e.g. to go to a safe state (NULL to remove)
+void STBS_SetEventHook(STBS* scheduler, STBS_EventHook hook);
+
+// Copies the statistics of the task with provided id
+// returns 0 on success, -1 if the task is not in the task list
+int STBS_GetTaskStats(STBS* scheduler, char* task_id, STBS_TaskStats* stats);
+
+// Copies the scheduler overhead and CPU load statistics
+void STBS_GetStats(STBS* scheduler, STBS_Stats* stats);
+
+// Clears all task and scheduler statistics
+void STBS_ResetStats(STBS* scheduler);
+
+// returns the average of a statistic in microseconds, 0 if empty
+uint32_t STBS_StatAvg(const STBS_Stat* stat);
+
+// Writes the trace through write: header, task names, then the records oldest first.
+// Recording pauses during the dump. Does nothing if STBS_TRACE is 0.
+void STBS_TraceDump(STBS* scheduler, STBS_TraceWriter write, void* ctx);
+
+// Empties the trace
+void STBS_TraceClear(void);
+
 // Prints contents of the STBS
 void STBS_print(STBS* scheduler);
 
+// Prints timing statistics of the scheduler and of every task
+void STBS_printStats(STBS* scheduler);
+
+// Prints the load of every tick of the macrocycle that releases something
+void STBS_printLoadProfile(STBS* scheduler);
+
 // Prints information of a certain task in scheduler with provided id
 void STBS_printTaskByID(STBS* scheduler, char* task_id);
 
@@ -62,9 +576,9 @@ void STBS_printTaskByID(STBS* scheduler, char* task_id);
 void STBS_printTask(Task* t);
 
 // returns greater common divisor between integers a and b
-uint32_t GCD(uint32_t a, uint32_t b);
+uint64_t GCD(uint64_t a, uint64_t b);
 
-// returns least common multiple between integers a and b
-uint32_t LCM(uint32_t a, uint32_t b);
+// returns least common multiple between integers a and b, 0 if it does not fit 64 bits
+uint64_t LCM(uint64_t a, uint64_t b);
 
 #endif
\ No newline at end of file
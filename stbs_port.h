@@ -0,0 +1,17 @@
+#ifndef DEF_STBS_PORT
+#define DEF_STBS_PORT
+
+// Platform layer of the STBS core.
+// On the board this is Zephyr itself. With STBS_HOST defined, the same subset of the
+// kernel API (threads, sleeping, semaphores, locks, atomics, clock and logging) is provided by
+// host/stbs_port_host.c on a virtual clock, so stbs.c builds and runs on Linux.
+#ifdef STBS_HOST
+#include "host/stbs_port_host.h"
+#else
+#include <zephyr/kernel.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/logging/log.h>
+#endif
+
+#endif
@@ -1,106 +1,132 @@
 #include "uart_comm.h"
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
 
 LOG_MODULE_REGISTER(uart_comm);
 
-extern const struct device *uart_dev; // Referência à UART inicializada no stbs.c
+const struct device *uart_dev; // UART inicializada com uart_comm_init
 
-// Função para construir um frame UART
-void build_uart_frame(char *buffer, char device_id, char command, char *payload) {
-    uint16_t checksum = 0;
-    int i = 0;
+RING_BUF_DECLARE(uart_tx_ring, UART_TX_BUF_SIZE);
+K_MSGQ_DEFINE(uart_rx_frames, sizeof(uart_frame), UART_RX_FRAMES, 1);
 
-    // Símbolo de sincronização
-    buffer[i++] = UART_SYNC_SYMBOL;
+static struct k_spinlock uart_tx_lock;
 
-    // ID do dispositivo
-    buffer[i++] = device_id;
-    checksum += device_id;
+// Estado da receção, só usado pela ISR
+static uart_parser rx_parser;
+static uart_frame rx_frame;
+static uint32_t rx_dropped;
+static uint32_t rx_errors;
 
-    // Comando
-    buffer[i++] = command;
-    checksum += command;
-
-    // Payload
-    if (payload != NULL) {
-        while (*payload) {
-            buffer[i++] = *payload;
-            checksum += *payload++;
+// Passa um byte recebido ao parser e entrega a frame quando fica completa
+static void uart_rx_byte(uint8_t c) {
+    switch (uart_parser_feed(&rx_parser, c, &rx_frame)) {
+    case UART_PARSE_FRAME:
+        if (k_msgq_put(&uart_rx_frames, &rx_frame, K_NO_WAIT) != 0) {
+            rx_dropped++;
         }
+        break;
+    case UART_PARSE_ERROR:
+        rx_errors++;
+        break;
+    default:
+        break;
     }
+}
+
+// Rotina de interrupção da UART
+static void uart_isr(const struct device *dev, void *user_data) {
+    ARG_UNUSED(user_data);
+
+    while (uart_irq_update(dev) && uart_irq_is_pending(dev)) {
+        if (uart_irq_rx_ready(dev)) {
+            uint8_t buf[16];
+            int len;
+            while ((len = uart_fifo_read(dev, buf, sizeof(buf))) > 0) {
+                for (int i = 0; i < len; i++) {
+                    uart_rx_byte(buf[i]);
+                }
+            }
+        }
 
-    // Adiciona os 3 dígitos do checksum
-    char checksum_str[4];
-    snprintf(checksum_str, sizeof(checksum_str), "%03d", checksum % 1000);
-    for (int j = 0; j < 3; j++) {
-        buffer[i++] = checksum_str[j];
+        if (uart_irq_tx_ready(dev)) {
+            k_spinlock_key_t key = k_spin_lock(&uart_tx_lock);
+            uint8_t *data;
+            uint32_t len = ring_buf_get_claim(&uart_tx_ring, &data, UART_TX_BUF_SIZE);
+            if (len == 0) {
+                uart_irq_tx_disable(dev);  // Nada mais para enviar
+            } else {
+                int sent = uart_fifo_fill(dev, data, len);
+                ring_buf_get_finish(&uart_tx_ring, (sent > 0) ? sent : 0);
+            }
+            k_spin_unlock(&uart_tx_lock, key);
+        }
     }
+}
 
-    // Símbolo de fim do frame
-    buffer[i++] = UART_END_SYMBOL;
+// Inicializa a UART em modo de interrupções
+int uart_comm_init(const struct device *dev) {
+    if (!device_is_ready(dev)) {
+        LOG_ERR("UART não está pronta.\n");
+        return -ENODEV;
+    }
 
-    // Terminar a string
-    buffer[i] = '\0';
+    uart_dev = dev;
+    ring_buf_reset(&uart_tx_ring);
+    k_msgq_purge(&uart_rx_frames);
+    uart_parser_init(&rx_parser);
+    rx_dropped = 0;
+    rx_errors = 0;
+
+    int err = uart_irq_callback_user_data_set(dev, uart_isr, NULL);
+    if (err != 0) {
+        LOG_ERR("UART sem suporte para interrupções (%d).\n", err);
+        return err;
+    }
+    uart_irq_rx_enable(dev);
+    return 0;
 }
 
-// Função para interpretar um frame UART
-bool interpret_uart_frame(const char *frame, char *device_id, char *command, char *payload) {
-    // Verificar se o frame começa e termina com os símbolos corretos
-    if (frame[0] != UART_SYNC_SYMBOL || frame[strlen(frame) - 1] != UART_END_SYMBOL) {
-        LOG_ERR("Frame inválido: Falta símbolo de sincronização ou fim de frame.\n");
-        return false;
+// Função para enviar bytes via UART, sem esperar pelo envio
+int send_uart_bytes(const uint8_t *data, size_t len) {
+    k_spinlock_key_t key = k_spin_lock(&uart_tx_lock);
+    if (ring_buf_space_get(&uart_tx_ring) < len) {
+        k_spin_unlock(&uart_tx_lock, key);
+        return -ENOSPC;
     }
+    ring_buf_put(&uart_tx_ring, data, len);
+    k_spin_unlock(&uart_tx_lock, key);
 
-    // Extrair informações do frame
-    *device_id = frame[1];
-    *command = frame[2];
+    // A ISR de transmissão esvazia o buffer e desliga-se quando acaba
+    uart_irq_tx_enable(uart_dev);
+    return 0;
+}
 
-    // Extrair payload
-    int i = 3;
-    int payload_len = 0;
-    while (frame[i] != '\0' && frame[i] != UART_END_SYMBOL && payload_len < MAX_PAYLOAD_SIZE) {
-        payload[payload_len++] = frame[i++];
-    }
-    payload[payload_len] = '\0';
+// Função para enviar uma mensagem via UART, sem esperar pelo envio
+int send_uart_message(const char *message) {
+    size_t len = strlen(message);
 
-    // Verificar e calcular checksum
-    uint16_t checksum = 0;
-    for (i = 1; frame[i] != '\0' && frame[i] != UART_END_SYMBOL && i < (strlen(frame) - 4); i++) {
-        checksum += frame[i];
+    k_spinlock_key_t key = k_spin_lock(&uart_tx_lock);
+    if (ring_buf_space_get(&uart_tx_ring) < len + 1) {
+        k_spin_unlock(&uart_tx_lock, key);
+        return -ENOSPC;
     }
+    ring_buf_put(&uart_tx_ring, (const uint8_t *)message, len);
+    ring_buf_put(&uart_tx_ring, (const uint8_t *)"\n", 1);
+    k_spin_unlock(&uart_tx_lock, key);
 
-    // Comparar checksum
-    char received_checksum[4];
-    strncpy(received_checksum, &frame[strlen(frame) - 4], 3);
-    received_checksum[3] = '\0';
-    if (atoi(received_checksum) != (checksum % 1000)) {
-        LOG_ERR("Checksum inválido.\n");
-        return false;
-    }
+    uart_irq_tx_enable(uart_dev);
+    return 0;
+}
 
-    return true;
+// Função para receber uma frame via UART
+int receive_uart_frame(uart_frame *frame, k_timeout_t timeout) {
+    return k_msgq_get(&uart_rx_frames, frame, timeout);
 }
 
-// Função para enviar uma mensagem via UART
-void send_uart_message(const char *message) {
-    for (size_t i = 0; i < strlen(message); i++) {
-        uart_poll_out(uart_dev, message[i]);
-    }
-    uart_poll_out(uart_dev, '\n');
+uint32_t uart_rx_dropped(void) {
+    return rx_dropped;
 }
 
-// Função para receber uma mensagem via UART
-void receive_uart_message(char *buffer, size_t max_len) {
-    size_t i = 0;
-    int c;
-    while (i < max_len - 1) {
-        c = uart_poll_in(uart_dev, &buffer[i]);
-        if (c == 0) {  // Caráter lido com sucesso
-            if (buffer[i] == '\n') {
-                break;
-            }
-            i++;
-        }
-    }
-    buffer[i] = '\0';
+uint32_t uart_rx_errors(void) {
+    return rx_errors;
 }
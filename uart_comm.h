@@ -4,14 +4,32 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/uart.h>
 #include <string.h>
+#include "uart_frame.h"
 
-#define UART_SYNC_SYMBOL '!'
-#define UART_END_SYMBOL '#'
-#define MAX_PAYLOAD_SIZE 10
+// Frames completas à espera de serem lidas
+#define UART_RX_FRAMES 4
+// Bytes à espera de envio
+#define UART_TX_BUF_SIZE 128
 
-void build_uart_frame(char *buffer, char device_id, char command, char *payload);
-bool interpret_uart_frame(const char *frame, char *device_id, char *command, char *payload);
-void send_uart_message(const char *message);
-void receive_uart_message(char *buffer, size_t max_len);
+// A UART funciona por interrupções (CONFIG_UART_INTERRUPT_DRIVEN=y, CONFIG_RING_BUFFER=y):
+// a ISR passa cada byte recebido ao parser de uart_frame.h e entrega as frames válidas
+// numa fila, e envia o conteúdo do buffer de transmissão. Nenhuma função bloqueia o CPU
+// à espera da UART.
+int uart_comm_init(const struct device *dev);
+
+// Coloca len bytes no buffer de transmissão e retorna logo.
+// Retorna 0, ou -ENOSPC se não couberem (nada é enviado).
+int send_uart_bytes(const uint8_t *data, size_t len);
+
+// Como send_uart_bytes, para uma mensagem de texto seguida de '\n'
+int send_uart_message(const char *message);
+
+// Espera no máximo timeout por uma frame recebida; K_NO_WAIT serve para uma tarefa periódica.
+// Retorna 0, ou -EAGAIN/-ENOMSG se não houver nenhuma.
+int receive_uart_frame(uart_frame *frame, k_timeout_t timeout);
+
+// Frames perdidas por a fila estar cheia, e frames descartadas pelo parser
+uint32_t uart_rx_dropped(void);
+uint32_t uart_rx_errors(void);
 
 #endif // UART_COMM_H
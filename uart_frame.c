@@ -0,0 +1,310 @@
+#include "uart_frame.h"
+#include <string.h>
+
+// Estados do parser
+enum {
+    PARSE_IDLE,         // à procura de '!' ou de UART_BIN_SYNC
+    PARSE_TEXT,         // frame de texto, até ao '#'
+    PARSE_BIN_ID,
+    PARSE_BIN_LEN,
+    PARSE_BIN_BODY,
+    PARSE_BIN_CRC_HI,
+    PARSE_BIN_CRC_LO
+};
+
+// Corpo de uma frame de texto: device_id, command, payload e 4 dígitos de CRC
+#define TEXT_BODY_MAX (2 + MAX_PAYLOAD_SIZE + 4)
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+// Acrescenta um byte ao CRC-16/CCITT-FALSE, sem tabela
+static inline uint16_t crc16_byte(uint16_t crc, uint8_t byte) {
+    uint8_t x = (crc >> 8) ^ byte;
+    x ^= x >> 4;
+    return (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+}
+
+uint16_t uart_crc16(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = crc16_byte(crc, data[i]);
+    }
+    return crc;
+}
+
+static int hex_value(uint8_t c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+void uart_parser_init(uart_parser *parser) {
+    parser->state = PARSE_IDLE;
+    parser->count = 0;
+}
+
+// Valida o corpo de uma frame de texto (entre '!' e '#') e preenche frame
+static uart_parse_result parse_text(uart_parser *parser, uart_frame *frame) {
+    uint8_t n = parser->count;
+    uint16_t received = 0;
+
+    if (n < 6)
+        return UART_PARSE_ERROR;
+    for (int i = n - 4; i < n; i++) {
+        int v = hex_value(parser->buf[i]);
+        if (v < 0)
+            return UART_PARSE_ERROR;
+        received = (received << 4) | v;
+    }
+    if (uart_crc16(0xFFFF, parser->buf, n - 4) != received)
+        return UART_PARSE_ERROR;
+
+    frame->device_id = parser->buf[0];
+    frame->binary = false;
+    frame->n_records = 1;
+    frame->records[0].command = parser->buf[1];
+    frame->records[0].offset = 0;
+    frame->records[0].len = n - 6;
+    memcpy(frame->payload, &parser->buf[2], n - 6);
+    frame->payload[n - 6] = '\0';
+    return UART_PARSE_FRAME;
+}
+
+// Separa os registos de uma frame binária com CRC válido
+static uart_parse_result parse_binary(uart_parser *parser, uart_frame *frame) {
+    uint8_t i = 0;
+
+    frame->device_id = parser->device_id;
+    frame->binary = true;
+    frame->n_records = 0;
+    while (i < parser->len) {
+        if (frame->n_records == UART_MAX_RECORDS || parser->len - i < 2)
+            return UART_PARSE_ERROR;
+        uint8_t len = parser->buf[i + 1];
+        if (parser->len - i - 2 < len)
+            return UART_PARSE_ERROR;
+
+        uart_record *record = &frame->records[frame->n_records++];
+        record->command = parser->buf[i];
+        record->offset = i + 2;
+        record->len = len;
+        i += 2 + len;
+    }
+    memcpy(frame->payload, parser->buf, parser->len);
+    frame->payload[parser->len] = '\0';
+    return UART_PARSE_FRAME;
+}
+
+// Processa um byte. Quando descarta uma frame binária (comprimento ou CRC inválidos),
+// *dropped fica com o número de bytes dela depois do UART_BIN_SYNC e, se raw não for
+// NULL, esses bytes são copiados para raw; senão *dropped fica a 0.
+static uart_parse_result parser_step(uart_parser *parser, uint8_t byte, uart_frame *frame,
+                                     uint8_t *raw, uint8_t *dropped) {
+    *dropped = 0;
+    switch (parser->state) {
+    case PARSE_IDLE:
+        if (byte == UART_SYNC_SYMBOL) {
+            parser->state = PARSE_TEXT;
+            parser->count = 0;
+        } else if (byte == UART_BIN_SYNC) {
+            parser->state = PARSE_BIN_ID;
+            parser->crc = 0xFFFF;
+        }
+        return UART_PARSE_MORE;
+
+    case PARSE_TEXT:
+        if (byte == UART_SYNC_SYMBOL) {
+            parser->count = 0;
+            return UART_PARSE_ERROR;
+        }
+        if (byte == UART_END_SYMBOL) {
+            parser->state = PARSE_IDLE;
+            return parse_text(parser, frame);
+        }
+        if (parser->count == TEXT_BODY_MAX) {
+            parser->state = PARSE_IDLE;
+            return UART_PARSE_ERROR;
+        }
+        parser->buf[parser->count++] = byte;
+        return UART_PARSE_MORE;
+
+    case PARSE_BIN_ID:
+        parser->device_id = byte;
+        parser->crc = crc16_byte(parser->crc, byte);
+        parser->state = PARSE_BIN_LEN;
+        return UART_PARSE_MORE;
+
+    case PARSE_BIN_LEN:
+        if (byte > UART_MAX_FRAME_PAYLOAD) {
+            parser->state = PARSE_IDLE;
+            if (raw != NULL) {
+                raw[0] = parser->device_id;
+                raw[1] = byte;
+            }
+            *dropped = 2;
+            return UART_PARSE_ERROR;
+        }
+        parser->len = byte;
+        parser->count = 0;
+        parser->crc = crc16_byte(parser->crc, byte);
+        parser->state = (byte > 0) ? PARSE_BIN_BODY : PARSE_BIN_CRC_HI;
+        return UART_PARSE_MORE;
+
+    case PARSE_BIN_BODY:
+        parser->buf[parser->count++] = byte;
+        parser->crc = crc16_byte(parser->crc, byte);
+        if (parser->count == parser->len)
+            parser->state = PARSE_BIN_CRC_HI;
+        return UART_PARSE_MORE;
+
+    case PARSE_BIN_CRC_HI:
+        parser->crc_hi = byte;
+        parser->state = PARSE_BIN_CRC_LO;
+        return UART_PARSE_MORE;
+
+    case PARSE_BIN_CRC_LO:
+        parser->state = PARSE_IDLE;
+        if ((((uint16_t)parser->crc_hi << 8) | byte) != parser->crc) {
+            if (raw != NULL) {
+                raw[0] = parser->device_id;
+                raw[1] = parser->len;
+                memcpy(&raw[2], parser->buf, parser->len);
+                raw[2 + parser->len] = parser->crc_hi;
+                raw[3 + parser->len] = byte;
+            }
+            *dropped = parser->len + 4;
+            return UART_PARSE_ERROR;
+        }
+        return parse_binary(parser, frame);
+
+    default:
+        parser->state = PARSE_IDLE;
+        return UART_PARSE_ERROR;
+    }
+}
+
+// Processa um byte recebido. Um '!' ou UART_BIN_SYNC fora de uma frame começa uma
+// frame nova; um '!' a meio de uma frame de texto volta a sincronizar nele.
+// Uma frame binária não tem símbolo de fim e o 0xA5 pode aparecer nos dados, por isso
+// só se sabe que um 0xA5 a meio começava outra frame quando a atual é descartada: os
+// bytes dela a seguir ao sync são então processados de novo, como se a frame não
+// tivesse começado. Uma frame encontrada nesses bytes é devolvida em vez do erro.
+uart_parse_result uart_parser_feed(uart_parser *parser, uint8_t byte, uart_frame *frame) {
+    uint8_t raw[UART_BIN_FRAME_SIZE];
+    uint8_t n;
+    uint8_t dropped;
+
+    uart_parse_result result = parser_step(parser, byte, frame, raw, &n);
+    for (uint8_t pos = 0; pos < n;) {
+        if (parser_step(parser, raw[pos++], frame, NULL, &dropped) == UART_PARSE_FRAME)
+            result = UART_PARSE_FRAME;
+        // Outra frame descartada, que começou nestes bytes: retoma a seguir ao sync dela
+        pos -= dropped;
+    }
+    return result;
+}
+
+// Função para construir um frame UART
+size_t build_uart_frame(char *buffer, size_t size, char device_id, char command, const char *payload) {
+    size_t payload_len = (payload != NULL) ? strlen(payload) : 0;
+    size_t i = 0;
+
+    if (payload_len > MAX_PAYLOAD_SIZE || size < 3 + payload_len + 4 + 1 + 1)
+        return 0;
+
+    // Os símbolos de início e fim não podem aparecer dentro da frame
+    if (device_id == UART_SYNC_SYMBOL || device_id == UART_END_SYMBOL ||
+        command == UART_SYNC_SYMBOL || command == UART_END_SYMBOL)
+        return 0;
+    for (size_t j = 0; j < payload_len; j++) {
+        if (payload[j] == UART_SYNC_SYMBOL || payload[j] == UART_END_SYMBOL)
+            return 0;
+    }
+
+    // Símbolo de sincronização
+    buffer[i++] = UART_SYNC_SYMBOL;
+
+    // ID do dispositivo, comando e payload
+    buffer[i++] = device_id;
+    buffer[i++] = command;
+    memcpy(&buffer[i], payload, payload_len);
+    i += payload_len;
+
+    // Os 4 dígitos hexadecimais do CRC
+    uint16_t crc = uart_crc16(0xFFFF, (const uint8_t *)&buffer[1], i - 1);
+    buffer[i++] = hex_digits[(crc >> 12) & 0xF];
+    buffer[i++] = hex_digits[(crc >> 8) & 0xF];
+    buffer[i++] = hex_digits[(crc >> 4) & 0xF];
+    buffer[i++] = hex_digits[crc & 0xF];
+
+    // Símbolo de fim do frame
+    buffer[i++] = UART_END_SYMBOL;
+
+    // Terminar a string
+    buffer[i] = '\0';
+    return i;
+}
+
+// Função para interpretar um frame UART de texto completo
+bool interpret_uart_frame(const char *frame, char *device_id, char *command, char *payload) {
+    uart_parser parser;
+    uart_frame decoded;
+
+    uart_parser_init(&parser);
+    for (size_t i = 0; frame[i] != '\0'; i++) {
+        uart_parse_result result = uart_parser_feed(&parser, frame[i], &decoded);
+        if (result == UART_PARSE_ERROR)
+            return false;
+        if (result == UART_PARSE_FRAME) {
+            if (decoded.binary || frame[i + 1] != '\0')
+                return false;
+            *device_id = decoded.device_id;
+            *command = decoded.records[0].command;
+            memcpy(payload, decoded.payload, decoded.records[0].len + 1);
+            return true;
+        }
+    }
+    return false;  // Falta o símbolo de fim do frame
+}
+
+void uart_bin_begin(uart_bin_writer *writer, uint8_t *buffer, size_t size, char device_id) {
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->len = 3;
+    writer->n_records = 0;
+    writer->overflow = size < 3 + 2;
+    if (!writer->overflow) {
+        buffer[0] = UART_BIN_SYNC;
+        buffer[1] = device_id;
+    }
+}
+
+bool uart_bin_add(uart_bin_writer *writer, uint8_t command, const void *data, uint8_t len) {
+    size_t records_len = writer->len - 3;
+
+    if (writer->overflow || writer->n_records == UART_MAX_RECORDS ||
+        records_len + 2 + len > UART_MAX_FRAME_PAYLOAD || writer->len + 2 + len + 2 > writer->size) {
+        writer->overflow = true;
+        return false;
+    }
+    writer->buffer[writer->len++] = command;
+    writer->buffer[writer->len++] = len;
+    memcpy(&writer->buffer[writer->len], data, len);
+    writer->len += len;
+    writer->n_records++;
+    return true;
+}
+
+size_t uart_bin_end(uart_bin_writer *writer) {
+    if (writer->overflow)
+        return 0;
+
+    writer->buffer[2] = writer->len - 3;
+    uint16_t crc = uart_crc16(0xFFFF, &writer->buffer[1], writer->len - 1);
+    writer->buffer[writer->len++] = crc >> 8;
+    writer->buffer[writer->len++] = crc & 0xFF;
+    return writer->len;
+}
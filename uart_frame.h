@@ -0,0 +1,101 @@
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Protocolo das frames UART, sem dependências do Zephyr.
+//
+// Frame de texto, um comando:
+//   '!' device_id command payload CRC '#'
+// com o payload até MAX_PAYLOAD_SIZE caracteres (sem '!' nem '#') e o CRC em
+// 4 dígitos hexadecimais maiúsculos, calculado sobre device_id, command e payload.
+//
+// Frame binária, vários comandos (registos):
+//   0xA5 device_id len registos[len] crc_hi crc_lo
+// onde cada registo é  command data_len data[data_len]  e o CRC é calculado
+// sobre device_id, len e registos. Serve, por exemplo, para enviar o estado
+// completo de entradas e saídas numa única frame.
+//
+// CRC-16/CCITT-FALSE: polinómio 0x1021, valor inicial 0xFFFF.
+
+#define UART_SYNC_SYMBOL '!'
+#define UART_END_SYMBOL '#'
+#define UART_BIN_SYNC 0xA5
+#define MAX_PAYLOAD_SIZE 10
+
+// Bytes de registos numa frame binária e número máximo de registos
+#define UART_MAX_FRAME_PAYLOAD 64
+#define UART_MAX_RECORDS 8
+
+// Tamanho de uma frame de texto, com o terminador
+#define UART_TEXT_FRAME_SIZE (3 + MAX_PAYLOAD_SIZE + 4 + 1 + 1)
+// Tamanho máximo de uma frame binária
+#define UART_BIN_FRAME_SIZE (3 + UART_MAX_FRAME_PAYLOAD + 2)
+
+// Um comando de uma frame; os dados estão em frame->payload[offset]
+typedef struct {
+    uint8_t command;
+    uint8_t offset;
+    uint8_t len;
+} uart_record;
+
+// Frame descodificada. Numa frame de texto há um só registo e o payload
+// termina com '\0'.
+typedef struct {
+    char device_id;
+    bool binary;
+    uint8_t n_records;
+    uart_record records[UART_MAX_RECORDS];
+    uint8_t payload[UART_MAX_FRAME_PAYLOAD + 1];
+} uart_frame;
+
+typedef enum {
+    UART_PARSE_MORE,    // frame ainda incompleta
+    UART_PARSE_FRAME,   // frame válida em *frame
+    UART_PARSE_ERROR    // frame descartada (CRC, tamanho ou formato)
+} uart_parse_result;
+
+// Estado do parser, alimentado byte a byte (por exemplo na ISR de receção)
+typedef struct {
+    uint8_t state;
+    uint8_t device_id;
+    uint8_t len;        // bytes de registos anunciados (frame binária)
+    uint8_t count;      // bytes recebidos
+    uint16_t crc;
+    uint8_t crc_hi;
+    uint8_t buf[UART_MAX_FRAME_PAYLOAD];
+} uart_parser;
+
+uint16_t uart_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+void uart_parser_init(uart_parser *parser);
+uart_parse_result uart_parser_feed(uart_parser *parser, uint8_t byte, uart_frame *frame);
+
+// Escreve uma frame de texto em buffer (com '\0'); retorna o comprimento, ou 0 se o
+// payload for demasiado longo, não couber em size ou algum campo tiver '!' ou '#'
+size_t build_uart_frame(char *buffer, size_t size, char device_id, char command, const char *payload);
+
+// Interpreta uma frame de texto completa; payload deve ter MAX_PAYLOAD_SIZE + 1 bytes
+bool interpret_uart_frame(const char *frame, char *device_id, char *command, char *payload);
+
+// Construção de uma frame binária diretamente no buffer de quem chama:
+//   uart_bin_begin(&w, buf, sizeof(buf), 'A');
+//   uart_bin_add(&w, 'I', inputs, 4);
+//   uart_bin_add(&w, 'O', outputs, 4);
+//   size_t len = uart_bin_end(&w);
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t len;
+    uint8_t n_records;
+    bool overflow;
+} uart_bin_writer;
+
+void uart_bin_begin(uart_bin_writer *writer, uint8_t *buffer, size_t size, char device_id);
+bool uart_bin_add(uart_bin_writer *writer, uint8_t command, const void *data, uint8_t len);
+// Retorna o comprimento da frame, ou 0 se algum registo não coube
+size_t uart_bin_end(uart_bin_writer *writer);
+
+#endif // UART_FRAME_H